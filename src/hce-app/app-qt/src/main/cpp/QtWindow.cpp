@@ -142,7 +142,7 @@ struct QtWindow::Impl
       // setup frame view model
       ui->decodeView->setModel(streamFilter);
       ui->decodeView->setColumnWidth(StreamModel::Id, 50);
-      ui->decodeView->setColumnWidth(StreamModel::Time, 175);
+      ui->decodeView->setColumnWidth(StreamModel::Time, 200);
       ui->decodeView->setColumnWidth(StreamModel::Delta, 80);
       ui->decodeView->setColumnWidth(StreamModel::Rate, 80);
       ui->decodeView->setColumnWidth(StreamModel::Tech, 80);
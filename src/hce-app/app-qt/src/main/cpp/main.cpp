@@ -19,6 +19,7 @@
 
 */
 
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -71,6 +72,105 @@ void messageOutput(QtMsgType type, const QMessageLogContext &context, const QStr
    }
 }
 
+/*
+ * listener thread settings from configuration, settings found are added to configured as policy flags
+ */
+rt::Executor::ThreadPolicy listenerPolicy(unsigned int &configured)
+{
+   QSettings settings;
+
+   // normal scheduling by default, real-time settings need privileges and are only taken from configuration
+   rt::Executor::ThreadPolicy policy = rt::Executor::policy(rt::Executor::PRIORITY_NORMAL);
+
+   settings.beginGroup("listener");
+
+   if (settings.contains("scheduler") || settings.contains("priority"))
+      configured |= rt::Executor::POLICY_SCHEDULER;
+
+   if (settings.contains("scheduler"))
+   {
+      const QString scheduler = settings.value("scheduler").toString().toUpper();
+
+      if (scheduler == "FIFO")
+         policy.scheduler = rt::Executor::SCHEDULER_FIFO;
+      else if (scheduler == "RR")
+         policy.scheduler = rt::Executor::SCHEDULER_RR;
+      else
+         policy.scheduler = rt::Executor::SCHEDULER_OTHER;
+   }
+
+   if (settings.contains("priority"))
+      policy.priority = settings.value("priority").toInt();
+
+   if (settings.contains("cpus"))
+   {
+      configured |= rt::Executor::POLICY_AFFINITY;
+
+      policy.cpus.clear();
+
+      for (const auto &cpu: settings.value("cpus").toStringList())
+         policy.cpus.push_back(cpu.trimmed().toInt());
+   }
+
+   if (settings.contains("lockMemory"))
+      configured |= rt::Executor::POLICY_MEMORY_LOCK;
+
+   if (settings.contains("prefaultStack"))
+      configured |= rt::Executor::POLICY_STACK_PREFAULT;
+
+   policy.lockMemory = settings.value("lockMemory", false).toBool();
+   policy.prefaultStack = settings.value("prefaultStack", 0).toUInt();
+
+   settings.endGroup();
+
+   return policy;
+}
+
+/*
+ * check listener thread settings once task is started, failed settings are reported to the user only if configured
+ */
+void checkPolicy(const rt::Logger *log, const unsigned int configured, std::future<rt::Executor::PolicyStatus> &&result)
+{
+   // task is started as soon as a pool thread takes it, it should not take long
+   if (result.wait_for(std::chrono::seconds(2)) != std::future_status::ready)
+   {
+      log->warn("listener thread settings status not available");
+      return;
+   }
+
+   const auto [applied, unapplied] = result.get();
+
+   // defaults that could not be applied are only logged, nothing to fix by the user
+   if (unapplied & ~configured)
+      log->debug("listener default thread settings not applied: {}", {unapplied & ~configured});
+
+   const unsigned int failed = unapplied & configured;
+
+   if (!failed)
+   {
+      log->info("listener thread settings applied: {}", {applied});
+      return;
+   }
+
+   std::string settings;
+
+   if (failed & rt::Executor::POLICY_SCHEDULER)
+      settings += " scheduler/priority (requires real-time privileges, CAP_SYS_NICE or rtprio limit)";
+
+   if (failed & rt::Executor::POLICY_AFFINITY)
+      settings += " cpus (check CPU numbers are allowed for this process)";
+
+   if (failed & rt::Executor::POLICY_MEMORY_LOCK)
+      settings += " lockMemory (requires CAP_IPC_LOCK or memlock limit)";
+
+   if (failed & rt::Executor::POLICY_STACK_PREFAULT)
+      settings += " prefaultStack (size is limited to 1MB)";
+
+   log->warn("listener thread settings not applied:{}", {settings});
+
+   std::cerr << "warning: listener thread settings not applied:" << settings << std::endl;
+}
+
 int startApp(int argc, char *argv[])
 {
    const rt::Logger *log = rt::Logger::getLogger("app.main");
@@ -174,10 +274,22 @@ int startApp(int argc, char *argv[])
       log->info("JSON frame output enabled");
    }
 
+   // listener bridge device, by serial number or enumeration index as #<index>, and channel A or B
+   settings.beginGroup("listener");
+
+   const std::string device = settings.value("device").toString().toStdString();
+   const int channel = settings.value("channel", "A").toString().toUpper() == "B" ? 1 : 0;
+
+   settings.endGroup();
+
    // create executor service
    rt::Executor executor(128, 5);
 
-   executor.submit(hce::tasks::TargetListenerTask::construct(), rt::Executor::PRIORITY_HIGHEST);
+   unsigned int configured = 0;
+
+   const rt::Executor::ThreadPolicy policy = listenerPolicy(configured);
+
+   checkPolicy(log, configured, executor.submit(hce::tasks::TargetListenerTask::construct(device, channel), policy));
 
    // start application
    return QtApplication::exec();
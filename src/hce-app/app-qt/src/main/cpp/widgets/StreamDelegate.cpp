@@ -66,14 +66,25 @@ struct StreamDelegate::Impl
             return QString("%1").arg(value.toDouble(), 9, 'f', 6);
 
          case StreamWidget::DateTime:
-            return QDateTime::fromMSecsSinceEpoch(value.toLongLong()).toString("yy-MM-dd hh:mm:ss.zzz");
+         {
+            // nanoseconds since epoch, shown with microsecond resolution
+            const long long time = value.toLongLong();
+
+            return QString("%1%2").arg(QDateTime::fromMSecsSinceEpoch(time / 1000000).toString("yy-MM-dd hh:mm:ss.zzz")).arg(time / 1000 % 1000, 3, 10, QChar('0'));
+         }
 
          case StreamWidget::Elapsed:
          {
-            if (value.toLongLong() < 1000)
-               return QString("%1 ms").arg(static_cast<double>(value.toLongLong()) / 1000.0f, 3, 'f', 0);
+            // nanoseconds
+            const double elapsed = static_cast<double>(value.toLongLong());
+
+            if (elapsed < 1E6)
+               return QString("%1 us").arg(elapsed / 1E3, 3, 'f', 0);
+
+            if (elapsed < 1E9)
+               return QString("%1 ms").arg(elapsed / 1E6, 3, 'f', 3);
 
-            return QString("%1 s").arg(static_cast<double>(value.toLongLong()) / 1000.0f, 3, 'f', 0);
+            return QString("%1 s").arg(elapsed / 1E9, 3, 'f', 3);
          }
 
          case StreamWidget::Rate:
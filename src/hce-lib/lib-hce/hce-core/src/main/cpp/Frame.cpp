@@ -19,10 +19,133 @@
 
 */
 
+#include <mutex>
+#include <atomic>
+
 #include <hce/Frame.h>
 
+// payload bytes stored inline with frame metadata, larger frames use a separate buffer
+#define FRAME_INLINE_SIZE 256
+
 namespace hce {
 
+/*
+ * recycled storage for frame blocks, released blocks are linked in a free list and reused by next frames
+ */
+struct FramePool
+{
+   struct Block
+   {
+      Block *next;
+   };
+
+   std::mutex mutex;
+
+   // first released block
+   Block *available = nullptr;
+
+   // size of pooled blocks, set on first allocation
+   std::size_t blockSize = 0;
+
+   // pool counters
+   unsigned long long allocated = 0;
+   unsigned long long reused = 0;
+   unsigned long long released = 0;
+   unsigned long long free = 0;
+
+   // frames with payload larger than inline storage
+   std::atomic<unsigned long long> oversize {0};
+
+   void *acquire(const std::size_t size)
+   {
+      {
+         std::lock_guard lock(mutex);
+
+         if (!blockSize)
+            blockSize = size;
+
+         if (size == blockSize)
+         {
+            if (Block *block = available)
+            {
+               available = block->next;
+               reused++;
+               free--;
+               return block;
+            }
+
+            allocated++;
+         }
+      }
+
+      return ::operator new(size);
+   }
+
+   void release(void *ptr, const std::size_t size)
+   {
+      std::lock_guard lock(mutex);
+
+      if (size != blockSize)
+      {
+         ::operator delete(ptr);
+         return;
+      }
+
+      auto *block = static_cast<Block *>(ptr);
+
+      block->next = available;
+      available = block;
+      released++;
+      free++;
+   }
+
+   static FramePool &get()
+   {
+      // never destroyed, frames may be released by static objects after exit
+      static auto *pool = new FramePool();
+
+      return *pool;
+   }
+};
+
+/*
+ * allocator for frame blocks, control block and frame data are allocated in one block from pool
+ */
+template <typename T>
+struct FrameAllocator
+{
+   using value_type = T;
+
+   FrameAllocator() = default;
+
+   template <typename U>
+   FrameAllocator(const FrameAllocator<U> &)
+   {
+   }
+
+   T *allocate(const std::size_t n)
+   {
+      return static_cast<T *>(FramePool::get().acquire(n * sizeof(T)));
+   }
+
+   void deallocate(T *ptr, const std::size_t n)
+   {
+      FramePool::get().release(ptr, n * sizeof(T));
+   }
+
+   template <typename U>
+   bool operator==(const FrameAllocator<U> &) const
+   {
+      return true;
+   }
+
+   template <typename U>
+   bool operator!=(const FrameAllocator<U> &) const
+   {
+      return false;
+   }
+};
+
 struct Frame::Impl
 {
    unsigned int techType = 0;
@@ -30,19 +153,54 @@ struct Frame::Impl
    unsigned int frameFlags = 0;
    unsigned int frameRate = 0;
    unsigned long long frameTime = 0;
+
+   // inline payload storage, shared by buffer through frame reference
+   rt::Alloc<unsigned char> payload;
+
+   alignas(16) unsigned char data[FRAME_INLINE_SIZE];
+
+   Impl()
+   {
+      payload.data = data;
+      payload.size = FRAME_INLINE_SIZE;
+      payload.alignment = 16;
+   }
+
+   ~Impl()
+   {
+      // inline storage is not owned by allocation
+      payload.data = nullptr;
+   }
+
+   Impl(const Impl &) = delete;
+
+   Impl &operator=(const Impl &) = delete;
 };
 
 const Frame Frame::Nil;
 
-Frame::Frame() : ByteBuffer(), impl(std::make_shared<Impl>())
+Frame::Frame() : ByteBuffer(), impl(std::allocate_shared<Impl>(FrameAllocator<Impl>()))
 {
 }
 
-Frame::Frame(const unsigned int size) : ByteBuffer(size), impl(std::make_shared<Impl>())
+Frame::Frame(const unsigned int size) : ByteBuffer(), impl(std::allocate_shared<Impl>(FrameAllocator<Impl>()))
 {
+   if (size <= FRAME_INLINE_SIZE)
+   {
+      // payload lives in frame block, buffer reference keeps it alive
+      alloc = std::shared_ptr<rt::Alloc<unsigned char>>(impl, &impl->payload);
+      state = {0, size, size};
+      attrs = {0, 1, 1, nullptr};
+   }
+   else
+   {
+      FramePool::get().oversize++;
+
+      ByteBuffer::operator=(ByteBuffer(size));
+   }
 }
 
-Frame::Frame(const unsigned int techType, const unsigned int frameType, const unsigned long long frameTime) : Frame(256)
+Frame::Frame(const unsigned int techType, const unsigned int frameType, const unsigned long long frameTime) : Frame(FRAME_INLINE_SIZE)
 {
    impl->techType = techType;
    impl->frameType = frameType;
@@ -169,4 +327,13 @@ void Frame::setFrameTime(unsigned long long frameTime)
    impl->frameTime = frameTime;
 }
 
+Frame::PoolStats Frame::poolStats()
+{
+   FramePool &pool = FramePool::get();
+
+   std::lock_guard lock(pool.mutex);
+
+   return {pool.allocated, pool.reused, pool.released, pool.free, pool.oversize.load()};
+}
+
 }
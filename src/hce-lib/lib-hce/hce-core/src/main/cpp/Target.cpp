@@ -33,7 +33,7 @@ bool Target::set(int id, const rt::Variant &value)
    return false;
 }
 
-void Target::select()
+void Target::select(const ActivationInfo &info)
 {
 }
 
@@ -0,0 +1,58 @@
+/*
+
+  This file is part of HCE-LABORATORY.
+
+  Copyright (C) 2025 Jose Vicente Campos Martinez, <josevcm@gmail.com>
+
+  HCE-LABORATORY is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HCE-LABORATORY is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with HCE-LABORATORY. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef HCE_ACTIVATIONINFO_H
+#define HCE_ACTIVATIONINFO_H
+
+#include <iterator>
+
+#include <rt/ByteBuffer.h>
+
+namespace hce {
+
+/*
+ * target activation by remote reader, as reported by NFC controller
+ */
+struct ActivationInfo
+{
+   unsigned int techType = 0; // NFC technology, as FrameTech
+   unsigned int protocol = 0; // RF protocol (0x04 for ISO-DEP)
+   unsigned int txRate = 0; // bit rate from target to reader, in bits per second
+   unsigned int rxRate = 0; // bit rate from reader to target, in bits per second
+   unsigned int frameSize = 0; // maximum frame size accepted by reader (FSD), 0 if unknown
+   int cid = -1; // card identifier assigned by reader, -1 if unknown
+   unsigned int maxPayload = 0; // maximum data payload per packet between host and NFC controller
+   rt::ByteBuffer params; // activation parameters sent by reader (RATS parameter byte for ISO-DEP), shares receive buffer
+
+   /*
+    * frame size for FSDI value, as defined in ISO/IEC 14443-4
+    */
+   static unsigned int fsdiToSize(const unsigned int fsdi)
+   {
+      static const unsigned int table[] = {16, 24, 32, 40, 48, 64, 96, 128, 256, 512, 1024, 2048, 4096};
+
+      return fsdi < std::size(table) ? table[fsdi] : 256;
+   }
+};
+
+}
+
+#endif
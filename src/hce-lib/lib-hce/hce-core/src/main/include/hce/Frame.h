@@ -57,6 +57,16 @@ class Frame : public rt::ByteBuffer
 
       static const Frame Nil;
 
+      // frame pool counters
+      struct PoolStats
+      {
+         unsigned long long allocated; // blocks obtained from system allocator
+         unsigned long long reused; // blocks taken from free list
+         unsigned long long released; // blocks returned to free list
+         unsigned long long available; // blocks currently in free list
+         unsigned long long oversize; // frames with payload not fitting in frame block
+      };
+
    public:
 
       Frame();
@@ -101,10 +111,13 @@ class Frame : public rt::ByteBuffer
 
       void setFrameRate(unsigned int frameRate);
 
+      // frame time in nanoseconds since epoch
       unsigned long long frameTime() const;
 
       void setFrameTime(unsigned long long frameTime);
 
+      static PoolStats poolStats();
+
    private:
 
       std::shared_ptr<Impl> impl;
@@ -25,6 +25,8 @@
 #include <rt/ByteBuffer.h>
 #include <rt/Variant.h>
 
+#include <hce/ActivationInfo.h>
+
 namespace hce {
 
 class Target
@@ -39,6 +41,7 @@ class Target
          PARAM_RATS_TB1 = 10, // byte TB1, WFT / SFGT (example 0x81 for FWT=77,33 ms, SFGT=0,60ms)
          PARAM_RATS_TC1 = 11, // byte TC1
          PARAM_RATS_HB = 12, // Historical bytes
+         PARAM_MAX_BITRATE = 20, // maximum bit rate in listen mode, in bits per second (106000, 212000, 424000 or 848000)
       };
 
    public:
@@ -55,7 +58,7 @@ class Target
 
       virtual bool set(int id, const rt::Variant &value);
 
-      virtual void select();
+      virtual void select(const ActivationInfo &info);
 
       virtual void deselect();
 
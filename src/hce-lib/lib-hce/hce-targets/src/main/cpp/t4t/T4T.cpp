@@ -38,6 +38,7 @@ struct T4T::Impl
    unsigned char targetTC1 = 0x02;
    rt::ByteBuffer targetHB = {0x80};
    rt::ByteBuffer targetUID = rt::ByteBuffer::random(7);
+   unsigned int targetMaxBitRate = 848000;
 
    explicit Impl()
    {
@@ -65,6 +66,9 @@ struct T4T::Impl
          case PARAM_RATS_HB:
             return targetHB;
 
+         case PARAM_MAX_BITRATE:
+            return targetMaxBitRate;
+
          default:
             return {};
       }
@@ -140,6 +144,17 @@ struct T4T::Impl
             log->error("invalid value type for PARAM_RATS_HIST");
             return false;
          }
+         case PARAM_MAX_BITRATE:
+         {
+            if (const auto v = std::get_if<unsigned int>(&value))
+            {
+               targetMaxBitRate = *v;
+               return true;
+            }
+
+            log->error("invalid value type for PARAM_MAX_BITRATE");
+            return false;
+         }
          default:
             log->warn("unknown or unsupported configuration id {}", {id});
             return false;
@@ -176,8 +191,10 @@ bool T4T::set(const int id, const rt::Variant &value)
    return impl->setParam(id, value);
 }
 
-void T4T::select()
+void T4T::select(const ActivationInfo &info)
 {
+   LOG_DEBUG(impl->log, "T4T selected, FSD {} CID {} bit rate {}/{}", {info.frameSize, info.cid, info.rxRate, info.txRate});
+
    impl->selectCard();
 }
 
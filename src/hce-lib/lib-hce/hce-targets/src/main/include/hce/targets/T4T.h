@@ -38,7 +38,7 @@ class T4T final : public Target
 
       bool set(int id, const rt::Variant &value) override;
 
-      void select() override;
+      void select(const ActivationInfo &info) override;
 
       void deselect() override;
 
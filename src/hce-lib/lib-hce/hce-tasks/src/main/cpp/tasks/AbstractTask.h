@@ -65,13 +65,15 @@ struct AbstractTask
       commandSubscription = commandSubject->subscribe([this](const rt::Event &command) { commandQueue.add(command); });
    }
 
-   void updateStatus(int code, const json &data)
+   void updateStatus(int code, const json &data, bool periodic = false)
    {
       if (data != lastStatus)
       {
          lastStatus = data;
 
-         log->info("status update: {}", {data.dump()});
+         // periodic updates only carry statistics, do not flood log
+         if (!periodic)
+            log->info("status update: {}", {data.dump()});
       }
 
       statusSubject->next({code, {{"data", data.dump()}}}, true);
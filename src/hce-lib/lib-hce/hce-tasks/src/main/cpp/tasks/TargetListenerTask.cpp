@@ -19,8 +19,16 @@
 
 */
 
+#include <cctype>
 #include <cmath>
+#include <cstdlib>
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <rt/Histogram.h>
+#include <rt/RingQueue.h>
 
 #include <hw/ic/PN7160.h>
 
@@ -32,11 +40,35 @@
 
 #include "AbstractTask.h"
 
+// initial request buffer size, grows as needed when reader sends segmented messages
+#define LISTENER_REQUEST_SIZE 1024
+
+// response buffer size, enough for extended length APDU (65536 bytes and status word)
+#define LISTENER_RESPONSE_SIZE 65538
+
+// maximum time listener sleeps without events or commands, in milliseconds
+#define LISTENER_WAIT_TIMEOUT 1000
+
+// frames waiting to be published, listener drops frames instead of blocking when full
+#define LISTENER_FRAME_QUEUE 1024
+
+// interval between statistics published in status stream, in milliseconds
+#define LISTENER_STATS_INTERVAL 1000
+
 namespace hce::tasks {
 
+// NCI bit rate codes, in bits per second
+static constexpr unsigned int BIT_RATES[] = {106000, 212000, 424000, 848000, 1695000, 3390000, 6780000};
+
 struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
 {
-   int listenerStatus = 0;
+   std::atomic<int> listenerStatus {0};
+
+   // bridge device selector, empty for first one
+   std::string device;
+
+   // bridge channel, 0 = A, 1 = B
+   int channel;
 
    hw::PN7160 pn7160;
 
@@ -46,10 +78,95 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
 
    rt::Subject<Frame> *listenerFrameStream = nullptr;
 
-   explicit Impl() : AbstractTask("worker.TargetListener", "target.listener"), pn7160(hw::PN7160::SPI)
+   // bit rates from reader to target and from target to reader, in bits per second
+   unsigned int rxRate = 106000;
+   unsigned int txRate = 106000;
+
+   // raised by NCI events and commands, listener sleeps on it while there is nothing to do
+   std::shared_ptr<rt::Waitable> wakeup = std::make_shared<rt::Waitable>();
+
+   // termination requested, listener loop must finish
+   std::atomic<bool> terminating {false};
+
+   // wall clock and steady clock nanoseconds at start of listening session
+   unsigned long long anchorWall = 0;
+   unsigned long long anchorSteady = 0;
+
+   // request and response buffers, reused between exchanges
+   rt::ByteBuffer request = rt::ByteBuffer(LISTENER_REQUEST_SIZE);
+   rt::ByteBuffer response = rt::ByteBuffer(LISTENER_RESPONSE_SIZE);
+
+   // last response queued to reader, published once its last byte is sent so listener never waits for the bus
+   Frame sentFrame = Frame::Nil;
+   unsigned long long sentQueueTime = 0;
+   unsigned long long sentIrqTime = 0;
+
+   // frames produced by listener thread and delivered to subscribers by publisher thread
+   rt::RingQueue<Frame> frameQueue = rt::RingQueue<Frame>(LISTENER_FRAME_QUEUE, Frame::Nil);
+
+   // raised by listener when frames are queued
+   std::shared_ptr<rt::Waitable> frameSignal = std::make_shared<rt::Waitable>();
+
+   // frames discarded because publisher did not keep up
+   std::atomic<unsigned long> framesDropped {0};
+
+   // publisher thread
+   std::atomic<bool> publishRunning {false};
+   std::thread publishThread;
+
+   // latency in nanoseconds from IRQ to listener, target processing, response queued to sent and IRQ to response sent
+   rt::Histogram receiveLatency;
+   rt::Histogram processLatency;
+   rt::Histogram sendLatency;
+   rt::Histogram totalLatency;
+
+   // transaction counters, updated by listener and read by publisher
+   std::atomic<unsigned long long> apduCount {0};
+   std::atomic<unsigned long long> activationCount {0};
+   std::atomic<unsigned long long> deactivationCount {0};
+   std::atomic<unsigned long long> errorCount {0};
+
+   // status is updated from listener and publisher threads
+   std::mutex statusMutex;
+
+   // last statistics snapshot, owned by publisher
+   unsigned long long statsTime = 0;
+   unsigned long long statsApdus = 0;
+   unsigned long long statsAllocs = 0;
+   unsigned long long allocGrowth = 0;
+   double apduRate = 0;
+
+   explicit Impl(const std::string &device, int channel) : AbstractTask("worker.TargetListener", subject(device, channel)), device(device), channel(channel), pn7160(hw::PN7160::SPI)
    {
       // create frame stream subject
-      listenerFrameStream = rt::Subject<Frame>::name("target.listener.frame");
+      listenerFrameStream = rt::Subject<Frame>::name(subject(device, channel) + ".frame");
+
+      // target keeps its configuration between listening sessions
+      target = std::make_shared<targets::T4T>();
+
+      // commands and NCI events wake up listener
+      commandQueue.attach(wakeup);
+      pn7160.attach(wakeup);
+
+      anchorTime();
+
+      // started here so publisher does not inherit real-time settings applied to listener thread
+      publishStart();
+   }
+
+   ~Impl() override
+   {
+      publishStop();
+   }
+
+   void terminate() override
+   {
+      terminating = true;
+
+      // wake up listener so it sees termination without waiting for timeout
+      wakeup->notify();
+
+      Worker::terminate();
    }
 
    void start() override
@@ -62,14 +179,19 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
    void stop() override
    {
       log->info("stopping listener task");
+
+      publishStop();
    }
 
    bool loop() override
    {
+      if (terminating)
+         return false;
+
       /*
       * process pending commands
       */
-      if (auto command = commandQueue.get())
+      while (auto command = commandQueue.get())
       {
          log->debug("command [{}]", {command->code});
 
@@ -87,29 +209,36 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
                configureTarget(command.value());
                break;
 
+            case ResetStats:
+               resetStats(command.value());
+               break;
+
             default:
                log->warn("unknown command {}", {command->code});
                command->reject(UnknownCommand);
-               return true;
+               break;
          }
       }
 
-      if (pn7160)
-      {
-         process();
-      }
-      else
+      if (!pn7160)
       {
          refresh();
+         return true;
       }
 
+      // process all events already received
+      process();
+
+      // sleep until next NCI event or command, signal is raised by any of them so none is lost
+      wakeup->wait(LISTENER_WAIT_TIMEOUT);
+
       return true;
    }
 
    void refresh()
    {
       // try to open...
-      if (pn7160.open())
+      if (pn7160.open(config()))
       {
          log->info("device PN7160 open success!");
 
@@ -129,36 +258,7 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
    {
       log->info("starting discovery");
 
-      target = std::make_shared<targets::T4T>();
-
-      const auto atqa = target->get<unsigned short>(Target::PARAM_ATQA);
-      const auto sak = target->get<unsigned char>(Target::PARAM_SAK);
-      const auto tb1 = target->get<unsigned char>(Target::PARAM_RATS_TB1);
-      const auto tc1 = target->get<unsigned char>(Target::PARAM_RATS_TC1);
-      const auto uid = target->get<rt::Buffer<unsigned char>>(Target::PARAM_UID);
-      const auto hist = target->get<rt::Buffer<unsigned char>>(Target::PARAM_RATS_HB);
-
-      const rt::ByteBuffer sn(uid.ptr(), uid.size());
-      const rt::ByteBuffer hb(hist.ptr(), hist.size());
-
-      parameters = {
-
-         // Listen Mode – NFC-A Discovery Parameters
-         {hw::PN7160::PARAM_LA_BIT_FRAME_SDD, {static_cast<unsigned char>(atqa >> 8)}}, // first byte of ATQA
-         {hw::PN7160::PARAM_LA_PLATFORM_CONFIG, {static_cast<unsigned char>(atqa & 0xff)}}, // second byte of ATQA
-         {hw::PN7160::PARAM_LA_SEL_INFO, {sak}}, // SAK
-         {hw::PN7160::PARAM_LA_NFCID1, sn}, // UID
-
-         // Listen Mode – ISO-DEP Discovery Parameters
-         {hw::PN7160::PARAM_LI_A_BIT_RATE, {0x00}}, // only 106Kbps
-         {hw::PN7160::PARAM_LI_A_RATS_TB1, {tb1}}, // FWT & SFGT
-         {hw::PN7160::PARAM_LI_A_RATS_TC1, {tc1}}, //
-         {hw::PN7160::PARAM_LI_A_HIST_BY, hb}, // historical bytes
-
-         // Other Parameters
-         {hw::PN7160::PARAM_RF_FIELD_INFO, {0x00}}, // notify when external field is detected
-         {hw::PN7160::PARAM_RF_NFCEE_ACTION, {0x01}}, // notify activation / deactivation
-      };
+      parameters = listenParameters();
 
       // starting discovery
       if (!pn7160.startDiscovery(parameters, hw::PN7160::DISCOVERY_LISTEN))
@@ -167,6 +267,9 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
          return;
       }
 
+      // new session, frame times are relative to this instant
+      anchorTime();
+
       updateListenerStatus(Listening);
    }
 
@@ -174,6 +277,8 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
    {
       log->info("stop discovery");
 
+      publishResponse(true);
+
       if (pn7160)
       {
          pn7160.stopDiscovery();
@@ -182,24 +287,141 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
       updateListenerStatus(Idle);
    }
 
+   /*
+    * apply target identity, only changed listen parameters are sent to NFCC if listening
+    */
    void configureTarget(const rt::Event &command)
    {
-      if (auto data = command.get<std::string>("data"))
+      const auto data = command.get<std::string>("data");
+
+      const json config = data ? json::parse(data.value(), nullptr, false) : json();
+
+      if (!config.is_object())
       {
-         auto config = json::parse(data.value());
+         log->warn("invalid config data");
+
+         command.reject(InvalidConfig);
+         return;
+      }
 
-         log->debug("change config: {}", {config.dump()});
+      log->debug("change config: {}", {config.dump()});
 
-         command.resolve();
+      std::vector<std::pair<int, rt::Variant>> changes;
 
-         updateListenerStatus(0);
+      // validate all values before changing anything
+      for (const auto &[key, value]: config.items())
+      {
+         unsigned int number = 0;
+         rt::ByteBuffer bytes;
+
+         if (key == "uid" && hexValue(value, bytes) && (bytes.size() == 4 || bytes.size() == 7 || bytes.size() == 10))
+            changes.emplace_back(Target::PARAM_UID, static_cast<const rt::Buffer<unsigned char> &>(bytes));
+         else if (key == "atqa" && intValue(value, 0xffff, number))
+            changes.emplace_back(Target::PARAM_ATQA, static_cast<unsigned short>(number));
+         else if (key == "sak" && intValue(value, 0xff, number))
+            changes.emplace_back(Target::PARAM_SAK, static_cast<unsigned char>(number));
+         else if (key == "tb1" && intValue(value, 0xff, number))
+            changes.emplace_back(Target::PARAM_RATS_TB1, static_cast<unsigned char>(number));
+         else if (key == "tc1" && intValue(value, 0xff, number))
+            changes.emplace_back(Target::PARAM_RATS_TC1, static_cast<unsigned char>(number));
+         else if (key == "hb" && hexValue(value, bytes) && bytes.size() <= 15)
+            changes.emplace_back(Target::PARAM_RATS_HB, static_cast<const rt::Buffer<unsigned char> &>(bytes));
+         else if (key == "maxBitRate" && intValue(value, BIT_RATES[3], number))
+            changes.emplace_back(Target::PARAM_MAX_BITRATE, number);
+         else
+         {
+            log->warn("invalid config parameter {}: {}", {key, value.dump()});
+
+            command.reject(InvalidConfig);
+            return;
+         }
       }
-      else
+
+      // current values, restored if new ones can't be applied
+      std::vector<std::pair<int, rt::Variant>> previous;
+
+      for (const auto &[id, value]: changes)
       {
-         log->warn("invalid config data");
+         previous.emplace_back(id, target->get(id));
 
-         command.reject(InvalidConfig);
+         if (!target->set(id, value))
+         {
+            restoreTarget(previous);
+
+            command.reject(InvalidConfig);
+            return;
+         }
       }
+
+      // running discovery is updated in place, otherwise values are used on next start
+      if (listenerStatus == Listening)
+      {
+         if (!pn7160.updateDiscovery(listenParameters()))
+         {
+            log->warn("update discovery failed, previous config restored");
+
+            restoreTarget(previous);
+
+            // NFCC could not resume discovery with previous values
+            if (pn7160.rfState() == hw::PN7160::RF_STATE_IDLE)
+               updateListenerStatus(Idle);
+
+            command.reject(ConfigFailed);
+            return;
+         }
+
+         parameters = listenParameters();
+      }
+
+      command.resolve();
+   }
+
+   /*
+    * set back target values saved before a failed configuration, in reverse order
+    */
+   void restoreTarget(const std::vector<std::pair<int, rt::Variant>> &previous)
+   {
+      for (auto it = previous.rbegin(); it != previous.rend(); ++it)
+      {
+         if (!target->set(it->first, it->second))
+            log->warn("unable to restore target parameter {}", {it->first});
+      }
+   }
+
+   std::vector<hw::PN7160::Parameter> listenParameters()
+   {
+      const auto atqa = target->get<unsigned short>(Target::PARAM_ATQA);
+      const auto sak = target->get<unsigned char>(Target::PARAM_SAK);
+      const auto tb1 = target->get<unsigned char>(Target::PARAM_RATS_TB1);
+      const auto tc1 = target->get<unsigned char>(Target::PARAM_RATS_TC1);
+      const auto uid = target->get<rt::Buffer<unsigned char>>(Target::PARAM_UID);
+      const auto hist = target->get<rt::Buffer<unsigned char>>(Target::PARAM_RATS_HB);
+
+      const rt::ByteBuffer sn(uid.ptr(), uid.size());
+      const rt::ByteBuffer hb(hist.ptr(), hist.size());
+
+      // maximum bit rate supported by target, only 106Kbps if not defined
+      const rt::Variant maxRate = target->get(Target::PARAM_MAX_BITRATE);
+      const auto bitRate = static_cast<unsigned char>(bitRateCode(std::get_if<unsigned int>(&maxRate) ? std::get<unsigned int>(maxRate) : 0));
+
+      return {
+
+         // Listen Mode – NFC-A Discovery Parameters
+         {hw::PN7160::PARAM_LA_BIT_FRAME_SDD, {static_cast<unsigned char>(atqa >> 8)}}, // first byte of ATQA
+         {hw::PN7160::PARAM_LA_PLATFORM_CONFIG, {static_cast<unsigned char>(atqa & 0xff)}}, // second byte of ATQA
+         {hw::PN7160::PARAM_LA_SEL_INFO, {sak}}, // SAK
+         {hw::PN7160::PARAM_LA_NFCID1, sn}, // UID
+
+         // Listen Mode – ISO-DEP Discovery Parameters
+         {hw::PN7160::PARAM_LI_A_BIT_RATE, {bitRate}}, // maximum bit rate
+         {hw::PN7160::PARAM_LI_A_RATS_TB1, {tb1}}, // FWT & SFGT
+         {hw::PN7160::PARAM_LI_A_RATS_TC1, {tc1}}, //
+         {hw::PN7160::PARAM_LI_A_HIST_BY, hb}, // historical bytes
+
+         // Other Parameters
+         {hw::PN7160::PARAM_RF_FIELD_INFO, {0x00}}, // notify when external field is detected
+         {hw::PN7160::PARAM_RF_NFCEE_ACTION, {0x01}}, // notify activation / deactivation
+      };
    }
 
    void process()
@@ -207,88 +429,476 @@ struct TargetListenerTask::Impl : TargetListenerTask, AbstractTask
       if (listenerStatus != Listening)
          return;
 
-      rt::ByteBuffer request(256);
-      rt::ByteBuffer response(256);
+      request.clear();
 
-      while (const int event = pn7160.waitEvent(request, 500))
+      // get events without waiting, listener sleeps on wake up signal between them
+      while (const int event = pn7160.waitEvent(request, 0))
       {
-         Frame requestFrame(NfcATech, NfcRequestFrame, request, timeMs());
+         // previous response goes before any new frame, reader has already got it if it sent something else
+         publishResponse(true);
+
+         // time when event is available to listener
+         const unsigned long long readTime = steadyTime();
+
+         // IRQ time of event, request frames are stamped when reader data reached the bus
+         const unsigned long long irqTime = pn7160.eventTime();
+         const unsigned long long eventTime = frameTime(irqTime);
+
+         // request and response buffers are reused by next exchange, so frames copy them into their pooled block
+         Frame requestFrame(NfcATech, NfcRequestFrame, request, eventTime);
+         requestFrame.setFrameRate(rxRate);
 
          // process received event
          if (event == hw::PN7160::EVENT_DATA)
          {
-            // prepare response frame
-            Frame responseFrame;
-
             // clear previous response
             response.clear();
 
+            apduCount.fetch_add(1, std::memory_order_relaxed);
+
+            receiveLatency.record(readTime - irqTime);
+
             if (target)
             {
+               const unsigned long long processTime = steadyTime();
+
                // process data from reader
                if (target->process(request, response) == 0)
                {
-                  responseFrame = Frame(NfcATech, NfcResponseFrame, response, timeMs() + 1);
+                  const unsigned long long queueTime = steadyTime();
+
+                  processLatency.record(queueTime - processTime);
 
                   // send response to reader
-                  if (!pn7160.sendData(response))
+                  if (pn7160.sendData(response))
                   {
+                     // response is stamped when its last byte is sent, listener is woken then
+                     sentFrame = Frame(NfcATech, NfcResponseFrame, response);
+                     sentFrame.setFrameRate(txRate);
+                     sentQueueTime = queueTime;
+                     sentIrqTime = irqTime;
+                  }
+                  else
+                  {
+                     errorCount.fetch_add(1, std::memory_order_relaxed);
+
                      log->warn("failed to send response to reader");
                   }
                }
                else
                {
+                  errorCount.fetch_add(1, std::memory_order_relaxed);
+
                   log->warn("target failed to process command");
                }
             }
 
             if (requestFrame)
-               listenerFrameStream->next(requestFrame);
-
-            if (responseFrame)
-               listenerFrameStream->next(responseFrame);
+               publish(requestFrame);
          }
          else if (event == hw::PN7160::EVENT_ACTIVATED)
          {
+            activationCount.fetch_add(1, std::memory_order_relaxed);
+
+            const ActivationInfo info = activationInfo();
+
+            // negotiated bit rates, used for all frames until next activation
+            rxRate = info.rxRate;
+            txRate = info.txRate;
+
             if (target)
-               target->select();
+               target->select(info);
 
-            Frame activateFrame(NfcATech, NfcActivateFrame, request, timeMs());
-            listenerFrameStream->next(activateFrame);
+            Frame activateFrame(info.techType, NfcActivateFrame, request, eventTime);
+            activateFrame.setFrameRate(rxRate);
+            publish(activateFrame);
          }
          else if (event == hw::PN7160::EVENT_DEACTIVATED)
          {
+            deactivationCount.fetch_add(1, std::memory_order_relaxed);
+
             if (target)
                target->deselect();
 
-            Frame deactivateFrame(NfcATech, NfcDeactivateFrame, request, timeMs());
-            listenerFrameStream->next(deactivateFrame);
+            Frame deactivateFrame(NfcATech, NfcDeactivateFrame, request, eventTime);
+            publish(deactivateFrame);
+
+            // keep listening for next activation
+            rearm();
          }
 
          // reset buffer for next read
          request.clear();
       }
+
+      // response may be already sent
+      publishResponse(false);
    }
 
-   void updateListenerStatus(const int status)
+   /*
+    * publish last response once all its data is sent, if forced it is published anyway stamped with current time
+    */
+   void publishResponse(const bool force)
    {
-      json data;
+      if (!sentFrame)
+         return;
 
-      listenerStatus = status;
+      const unsigned long long sendTime = pn7160.sendTime(0);
+
+      if (!sendTime && !force)
+         return;
+
+      if (sendTime)
+      {
+         sendLatency.record(sendTime - sentQueueTime);
+         totalLatency.record(sendTime - sentIrqTime);
+      }
+
+      sentFrame.setFrameTime(frameTime(sendTime ? sendTime : steadyTime()));
+
+      publish(sentFrame);
+
+      sentFrame = Frame::Nil;
+   }
+
+   /*
+    * queue frame for publisher thread, never blocks so subscribers can not delay response to reader
+    */
+   void publish(const Frame &frame)
+   {
+      if (!frameQueue.push(frame))
+      {
+         framesDropped.fetch_add(1, std::memory_order_relaxed);
+         return;
+      }
+
+      frameSignal->notify();
+   }
+
+   void publishStart()
+   {
+      publishRunning = true;
+
+      publishThread = std::thread([this] { publishLoop(); });
+   }
+
+   void publishStop()
+   {
+      publishRunning = false;
+
+      frameSignal->notify();
+
+      if (publishThread.joinable())
+         publishThread.join();
+   }
+
+   /*
+    * deliver queued frames to subscribers, runs on publisher thread
+    */
+   void publishLoop()
+   {
+      Frame frame = Frame::Nil;
+
+      unsigned long dropped = 0;
+
+      statsTime = steadyTime();
+
+      while (publishRunning)
+      {
+         const unsigned long long elapsed = (steadyTime() - statsTime) / 1000000;
 
-      if (status == Idle)
+         // wake up for frames or next statistics snapshot
+         frameSignal->wait(elapsed < LISTENER_STATS_INTERVAL ? static_cast<int>(LISTENER_STATS_INTERVAL - elapsed) : 0);
+
+         while (frameQueue.pop(frame))
+            listenerFrameStream->next(frame);
+
+         // report lost frames from here to keep logging out of listener thread
+         if (const unsigned long total = framesDropped.load(std::memory_order_relaxed); total != dropped)
+         {
+            log->warn("frame queue overflow, {} frames dropped ({} total)", {total - dropped, total});
+
+            dropped = total;
+         }
+
+         if (steadyTime() - statsTime >= LISTENER_STATS_INTERVAL * 1000000ull)
+            updateStats();
+      }
+
+      // flush frames queued before stop
+      while (frameQueue.pop(frame))
+         listenerFrameStream->next(frame);
+   }
+
+   /*
+    * periodic statistics snapshot, runs on publisher thread
+    */
+   void updateStats()
+   {
+      std::lock_guard lock(statusMutex);
+
+      const unsigned long long now = steadyTime();
+      const unsigned long long apdus = apduCount.load(std::memory_order_relaxed);
+
+      // counters may have been reset since last snapshot
+      apduRate = static_cast<double>(apdus >= statsApdus ? apdus - statsApdus : apdus) * 1E9 / static_cast<double>(now - statsTime);
+
+      const unsigned long long allocs = Frame::poolStats().allocated;
+
+      // frame pool is sized by first exchanges, afterwards blocks are reused and allocations stay flat
+      allocGrowth = allocs - statsAllocs;
+
+      if (allocGrowth > 0 && statsApdus > 0 && apdus > statsApdus)
+         log->warn("frame pool grew by {} blocks in steady state ({} total)", {allocGrowth, allocs});
+
+      statsTime = now;
+      statsApdus = apdus;
+      statsAllocs = allocs;
+
+      if (listenerStatus == Listening)
+         updateStatus(listenerStatus, statusData(), true);
+   }
+
+   void resetStats(const rt::Event &command)
+   {
+      log->info("reset statistics");
+
+      receiveLatency.reset();
+      processLatency.reset();
+      sendLatency.reset();
+      totalLatency.reset();
+
+      apduCount = 0;
+      activationCount = 0;
+      deactivationCount = 0;
+      errorCount = 0;
+
+      command.resolve();
+   }
+
+   json statusData() const
+   {
+      json data;
+
+      if (listenerStatus == Idle)
          data["status"] = "idle";
-      else if (status == Listening)
+      else if (listenerStatus == Listening)
          data["status"] = "listening";
       else
          data["status"] = "disabled";
 
-      updateStatus(status, data);
+      const Frame::PoolStats pool = Frame::poolStats();
+
+      data["stats"] = {
+         {"apdus", apduCount.load(std::memory_order_relaxed)},
+         {"apduRate", std::round(apduRate * 10) / 10},
+         {"activations", activationCount.load(std::memory_order_relaxed)},
+         {"deactivations", deactivationCount.load(std::memory_order_relaxed)},
+         {"errors", errorCount.load(std::memory_order_relaxed)},
+         {"dropped", framesDropped.load(std::memory_order_relaxed)},
+         {"frameAllocs", pool.allocated},
+         {"frameAllocsGrowth", allocGrowth},
+         {"latency", {
+            {"receive", latencyData(receiveLatency)},
+            {"process", latencyData(processLatency)},
+            {"send", latencyData(sendLatency)},
+            {"total", latencyData(totalLatency)},
+         }}
+      };
+
+      return data;
+   }
+
+   /*
+    * unsigned integer from JSON number or hexadecimal string
+    */
+   static bool intValue(const json &value, const unsigned int max, unsigned int &result)
+   {
+      if (value.is_number_unsigned())
+      {
+         result = value.get<unsigned int>();
+      }
+      else if (value.is_string())
+      {
+         const std::string text = value.get<std::string>();
+
+         char *end = nullptr;
+
+         result = std::strtoul(text.c_str(), &end, 16);
+
+         if (text.empty() || *end)
+            return false;
+      }
+      else
+      {
+         return false;
+      }
+
+      return result <= max;
+   }
+
+   /*
+    * bytes from hexadecimal string, spaces and colons between bytes are ignored
+    */
+   static bool hexValue(const json &value, rt::ByteBuffer &result)
+   {
+      if (!value.is_string())
+         return false;
+
+      std::string digits;
+
+      for (const char c: value.get<std::string>())
+      {
+         if (std::isxdigit(static_cast<unsigned char>(c)))
+            digits += c;
+         else if (c != ' ' && c != ':')
+            return false;
+      }
+
+      if (digits.empty() || digits.size() & 1)
+         return false;
+
+      result = rt::ByteBuffer(digits.size() / 2);
+
+      for (size_t i = 0; i < digits.size(); i += 2)
+         result.put(static_cast<unsigned char>(std::strtoul(digits.substr(i, 2).c_str(), nullptr, 16)));
+
+      result.flip();
+
+      return true;
+   }
+
+   /*
+    * histogram summary in microseconds
+    */
+   static json latencyData(const rt::Histogram &histogram)
+   {
+      return {
+         {"count", histogram.count()},
+         {"min", histogram.min() / 1E3},
+         {"mean", histogram.mean() / 1E3},
+         {"p50", histogram.percentile(50) / 1E3},
+         {"p90", histogram.percentile(90) / 1E3},
+         {"p99", histogram.percentile(99) / 1E3},
+         {"p999", histogram.percentile(99.9) / 1E3},
+         {"max", histogram.max() / 1E3},
+      };
+   }
+
+   static unsigned int bitRateCode(const unsigned int rate)
+   {
+      unsigned int code = 0;
+
+      // highest NCI bit rate not exceeding requested one, listen NFC-A is limited to 848Kbps
+      while (code < 3 && BIT_RATES[code + 1] <= rate)
+         code++;
+
+      return code;
+   }
+
+   ActivationInfo activationInfo() const
+   {
+      const hw::PN7160::Activation &activation = pn7160.lastActivation();
+
+      ActivationInfo info;
+
+      // listen NFC-B passive mode, all other ones are handled as NFC-A
+      info.techType = activation.mode == 0x81 ? NfcBTech : NfcATech;
+      info.protocol = activation.protocol;
+      info.txRate = activation.txBitRate < std::size(BIT_RATES) ? BIT_RATES[activation.txBitRate] : 0;
+      info.rxRate = activation.rxBitRate < std::size(BIT_RATES) ? BIT_RATES[activation.rxBitRate] : 0;
+      info.maxPayload = activation.maxPayload;
+      info.params = activation.activationParams;
+
+      // ISO-DEP over NFC-A, RATS parameter byte carries FSDI and CID
+      if (info.techType == NfcATech && info.protocol == 0x04 && info.params.remaining() > 0)
+      {
+         const unsigned int param = info.params[info.params.position()];
+
+         info.frameSize = ActivationInfo::fsdiToSize(param >> 4);
+         info.cid = static_cast<int>(param & 0x0F);
+      }
+
+      return info;
+   }
+
+   void rearm()
+   {
+      const auto [type, reason] = pn7160.lastDeactivation();
+
+      // NFCC is still in discovery loop (or already activated again), next activation is served as is
+      if (pn7160.rfState() != hw::PN7160::RF_STATE_IDLE)
+      {
+         log->debug("RF deactivated, type {} reason {}, ready for next activation", {type, reason});
+         return;
+      }
+
+      // deactivation requested by us
+      if (reason == hw::PN7160::DEACTIVATE_DH_REQUEST)
+         return;
+
+      log->info("RF deactivated to idle, reason {}, resume discovery", {reason});
+
+      if (!pn7160.resumeDiscovery())
+      {
+         log->warn("resume discovery failed");
+
+         updateListenerStatus(Idle);
+      }
+   }
+
+   void updateListenerStatus(const int status)
+   {
+      std::lock_guard lock(statusMutex);
+
+      listenerStatus = status;
+
+      updateStatus(status, statusData());
+   }
+
+   std::string config() const
+   {
+      std::string config = channel ? "channel=B" : "";
+
+      if (!device.empty())
+         config += (config.empty() ? "device=" : " device=") + device;
+
+      return config;
+   }
+
+   static std::string subject(const std::string &device, int channel)
+   {
+      std::string subject = "target.listener";
+
+      if (!device.empty())
+         subject += "." + device;
+
+      if (channel)
+         subject += ".b";
+
+      return subject;
+   }
+
+   /*
+    * take wall clock anchor for listening session, frames are stamped with steady clock offsets from it
+    */
+   void anchorTime()
+   {
+      anchorWall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      anchorSteady = steadyTime();
+   }
+
+   /*
+    * convert steady clock nanoseconds to frame time, nanoseconds since epoch
+    */
+   unsigned long long frameTime(const unsigned long long steady) const
+   {
+      return anchorWall + (steady - anchorSteady);
    }
 
-   static unsigned long long timeMs()
+   static unsigned long long steadyTime()
    {
-      return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
    }
 };
 
@@ -296,9 +906,9 @@ TargetListenerTask::TargetListenerTask() : Worker("TargetListener")
 {
 }
 
-rt::Worker *TargetListenerTask::construct()
+rt::Worker *TargetListenerTask::construct(const std::string &device, int channel)
 {
-   return new Impl;
+   return new Impl(device, channel);
 }
 
 }
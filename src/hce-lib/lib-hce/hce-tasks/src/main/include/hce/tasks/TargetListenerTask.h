@@ -22,6 +22,8 @@
 #ifndef TASKS_LISTENER_TARGET_TASK_H
 #define TASKS_LISTENER_TARGET_TASK_H
 
+#include <string>
+
 #include <rt/Worker.h>
 
 namespace hce::tasks {
@@ -34,7 +36,8 @@ class TargetListenerTask : public rt::Worker
       {
          Start,
          Stop,
-         Configure
+         Configure,
+         ResetStats
       };
 
       enum Status
@@ -49,6 +52,7 @@ class TargetListenerTask : public rt::Worker
       {
          NoError = 0,
          InvalidConfig = -2,
+         ConfigFailed = -3,
          UnknownCommand = -9
       };
 
@@ -66,7 +70,12 @@ class TargetListenerTask : public rt::Worker
 
    public:
 
-      static Worker *construct();
+      /*
+       * create listener for PN7160 attached to given bridge device and channel, device by serial number
+       * or "#<index>", first device if empty; listeners for explicit device or channel B use
+       * "target.listener.<device>[.b]" subjects
+       */
+      static Worker *construct(const std::string &device = std::string(), int channel = 0);
 };
 
 }
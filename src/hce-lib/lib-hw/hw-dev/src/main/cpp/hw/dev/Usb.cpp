@@ -84,6 +84,7 @@ struct Usb::Impl
    Descriptor descriptor {};
 
    std::list<TransferInfo *> transfers;
+   std::mutex transfersMutex;
 
    explicit Impl(Descriptor desc) : descriptor(std::move(desc))
    {
@@ -282,6 +283,17 @@ struct Usb::Impl
       return true;
    }
 
+   int vendorRequest(int direction, int request, int value, int index, void *data, unsigned int length, int timeout)
+   {
+      if ((result = libusb_control_transfer(hdl, LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE | direction, request, value, index, static_cast<unsigned char *>(data), length, timeout)) < 0)
+      {
+         log->error("unable to send vendor request {}: {}", {request, lastError()});
+         return -1;
+      }
+
+      return result;
+   }
+
    int syncTransfer(int endpoint, void *data, unsigned int length, int timeout)
    {
       int transferred = 0;
@@ -315,15 +327,20 @@ struct Usb::Impl
 
       libusb_fill_bulk_transfer(usbTransfer, hdl, endpoint, transfer->data, static_cast<int>(transfer->available), transferHandler, transferInfo, transfer->timeout);
 
+      std::lock_guard lock(transfersMutex);
+
+      // registered before submit, completion may be processed by event thread before returning
+      transfers.push_back(transferInfo);
+
       if ((result = libusb_submit_transfer(usbTransfer)) != LIBUSB_SUCCESS)
       {
+         transfers.pop_back();
          libusb_free_transfer(usbTransfer);
+         delete transferInfo;
          log->error("error in submit async transfer: {}", {lastError()});
          return false;
       }
 
-      transfers.push_back(transferInfo);
-
       return true;
    }
 
@@ -335,6 +352,8 @@ struct Usb::Impl
          return false;
       }
 
+      std::lock_guard lock(transfersMutex);
+
       for (const auto transferInfo: transfers)
       {
          if (transferInfo->transfer != transfer)
@@ -432,12 +451,15 @@ struct Usb::Impl
          }
       }
 
+      // remove from transfer list
+      {
+         std::lock_guard lock(transfersMutex);
+         transfers.remove(transferInfo);
+      }
+
       // free transfer owner
       delete transferInfo;
 
-      // remove from transfer list
-      transfers.remove(transferInfo);
-
       // free underline transfer
       libusb_free_transfer(usbTransfer);
    }
@@ -487,6 +509,11 @@ bool Usb::ctrlTransfer(int outCmd, const void *txData, unsigned int txSize, int
    return impl->ctrlTransfer(outCmd, txData, txSize, inCmd, rxData, rxSize, timeout, wait);
 }
 
+int Usb::vendorRequest(Direction direction, int request, int value, int index, void *data, unsigned int length, int timeout) const
+{
+   return impl->vendorRequest(direction ? LIBUSB_ENDPOINT_OUT : LIBUSB_ENDPOINT_IN, request, value, index, data, length, timeout);
+}
+
 int Usb::syncTransfer(Direction direction, int endpoint, void *data, unsigned int length, int timeout) const
 {
    return impl->syncTransfer((direction ? LIBUSB_ENDPOINT_OUT : LIBUSB_ENDPOINT_IN) | endpoint, data, length, timeout);
@@ -561,6 +588,7 @@ std::list<Usb::Descriptor> Usb::list()
       libusb_device_descriptor desc {};
       unsigned char manufacturer[64];
       unsigned char product[64];
+      unsigned char serial[64] {};
 
       /* Assume the FW has not been loaded, unless proven wrong. */
       if (libusb_get_device_descriptor(dev, &desc) != LIBUSB_SUCCESS)
@@ -581,6 +609,10 @@ std::list<Usb::Descriptor> Usb::list()
          continue;
       }
 
+      // serial number is optional
+      if (desc.iSerialNumber && libusb_get_string_descriptor_ascii(hdl, desc.iSerialNumber, serial, sizeof(serial)) < 0)
+         serial[0] = 0;
+
       // close device
       libusb_close(hdl);
 
@@ -589,12 +621,16 @@ std::list<Usb::Descriptor> Usb::list()
          .vid = desc.idVendor,
          .pid = desc.idProduct,
          .bus = libusb_get_bus_number(dev),
+         .port = libusb_get_port_number(dev),
          .address = libusb_get_device_address(dev),
          .manufacturer = rt::Format::trim(reinterpret_cast<char *>(manufacturer)),
          .product = rt::Format::trim(reinterpret_cast<char *>(product)),
+         .serial = rt::Format::trim(reinterpret_cast<char *>(serial)),
       });
    }
 
+   libusb_free_device_list(devs, 1);
+
    return devices;
 }
 
@@ -26,6 +26,14 @@
 
 #include <unistd.h>
 
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <algorithm>
+#include <condition_variable>
+
 #include <rt/Logger.h>
 #include <rt/Finally.h>
 
@@ -33,20 +41,55 @@
 
 #include <hw/ic/PN7160.h>
 
-// PN7160 timings in microseconds
-#define PN7160_T_WL_DWL   5000  // T_VDD_DWL time (in datasheet 0us)
-#define PN7160_T_WL_VDD   5000  // T_VDD_VEN time (in datasheet 0us)
-#define PN7160_T_WL_VEN   5000  // T_WL_VEN time (in datasheet 10us)
-#define PN7160_T_BOOT     5000  // T-BOOT time (in datasheet 2.5ms)
+// PN7160 timings, T_VDD_DWL and T_VDD_VEN are 0us in datasheet
+#define PN7160_T_WL_VEN   10    // T_WL_VEN time in microseconds (in datasheet 10us)
+#define PN7160_T_BOOT     5     // T-BOOT deadline in milliseconds waiting for boot IRQ (in datasheet 2.5ms)
 
 #define PN7160_DEFAULT_TIMEOUT 500
 
+// NCI I/O thread, IRQ wait slice and time given to caller to answer a data packet, in milliseconds
+#define PN7160_IO_SLICE        10
+#define PN7160_IO_TURNAROUND   20
+#define PN7160_IO_RESPONSE     250
+
+// NCI packet rings size, in packets
+#define PN7160_CONTROL_RING    2
+#define PN7160_NOTIFY_RING     8
+#define PN7160_DATA_RING       16
+#define PN7160_SEND_RING       8
+
+// NCI maximum packet size, header and 255 bytes payload
+#define NCI_MAX_PACKET         258
+#define NCI_MAX_PAYLOAD        255
+
+// NCI packet boundary flag, set in all segments of a message except the last one
+#define NCI_PBF                0x10
+
+// NCI logical connections, static RF connection is 0
+#define NCI_MAX_CONNECTIONS    16
+#define NCI_CONN_STATIC_RF     0
+
+// NCI initial credits value when flow control is not used
+#define NCI_CREDITS_UNLIMITED  0xFF
+
+// speculative payload bytes read with NCI header in SPI mode
+#define PN7160_SPI_READ_WINDOW 64
+
+// SPI clock limits, maximum by datasheet is 7MHz, up to 10MHz can be forced by config
+#define PN7160_SPI_DEFAULT_CLOCK hw::MPSSE::CLK_1MHZ
+#define PN7160_SPI_PROBE_CLOCK   7000000
+#define PN7160_SPI_MAX_CLOCK     hw::MPSSE::CLK_10MHZ
+#define PN7160_I2C_DEFAULT_CLOCK hw::MPSSE::CLK_100KHZ
+
 // PN7160 default pins to FT232H board
 #define PN7160_FT232H_IRQ_PIN hw::MPSSE::GPIOL1
 #define PN7160_FT232H_DWL_PIN hw::MPSSE::GPIOH2
 #define PN7160_FT232H_VEN_PIN hw::MPSSE::GPIOH3
 
 // NCI message types
+#define NCI_MT_MASK                    0xE0
+#define NCI_MT_RESPONSE                0x40
+#define NCI_MT_NOTIFICATION            0x60
 #define NCI_MT_DATA                    0x00
 #define NCI_MT_EVENT_CORE              0x60
 #define NCI_MT_EVENT_RF                0x61
@@ -58,6 +101,7 @@
 #define NCI_STATUS_OK                  0x00
 
 // NCI operations
+#define NCI_OP_CORE_RESET_NTF          0x00
 #define NCI_OP_CORE_CONN_CREDITS_NTF   0x06
 
 #define NCI_OP_RF_DISCOVERY_NTF        0x03
@@ -155,6 +199,74 @@ struct ListenRouting
    rt::ByteBuffer value;
 };
 
+/*
+ * fixed size ring of NCI packets, all slots are allocated on creation, access must be guarded by owner
+ */
+struct PacketRing
+{
+   struct Slot
+   {
+      rt::ByteBuffer packet;
+      unsigned long sequence;
+      unsigned long long time; // steady clock nanoseconds when IRQ was seen
+   };
+
+   std::vector<Slot> slots;
+
+   unsigned int head = 0;
+   unsigned int count = 0;
+
+   explicit PacketRing(const unsigned int size)
+   {
+      for (unsigned int i = 0; i < size; i++)
+         slots.push_back({rt::ByteBuffer(NCI_MAX_PACKET), 0, 0});
+   }
+
+   bool empty() const
+   {
+      return count == 0;
+   }
+
+   bool full() const
+   {
+      return count == slots.size();
+   }
+
+   unsigned int available() const
+   {
+      return slots.size() - count;
+   }
+
+   Slot &front()
+   {
+      return slots[head];
+   }
+
+   /*
+    * get next free slot and commit it, ring must not be full
+    */
+   Slot &push()
+   {
+      Slot &slot = slots[(head + count++) % slots.size()];
+
+      slot.packet.clear();
+
+      return slot;
+   }
+
+   void pop()
+   {
+      head = (head + 1) % slots.size();
+      count--;
+   }
+
+   void clear()
+   {
+      head = 0;
+      count = 0;
+   }
+};
+
 struct PN7160::Impl
 {
    rt::Logger *log = rt::Logger::getLogger("hw.PN7160");
@@ -232,15 +344,98 @@ struct PN7160::Impl
       // {0xA0, 0x0D, 0x06, 0x72, 0x4A, 0x57, 0x07, 0x00, 0x1B} // CLIF_ANA_TX_SHAPE_CONTROL_REG
    };
 
+   // open configuration options
+   struct Options
+   {
+      unsigned int clock;
+      unsigned int probe;
+      MPSSE::Transport transport;
+      MPSSE::Channel channel;
+      std::string device;
+   };
+
    MPSSE mpsse;
 
    Protocol protocol;
    unsigned char i2cAddress;
+   unsigned int readWindow;
    Status status = STATUS_CLOSED;
 
    std::string device;
 
-   Impl(const Protocol protocol, const unsigned char addr) : protocol(protocol), i2cAddress(addr)
+   // configuration TLVs known to be held by NFCC, by tag, cleared when NFCC configuration is reset
+   mutable std::map<unsigned int, rt::ByteBuffer> configCache;
+
+   // NCI I/O thread, owns the bus once device is initialized
+   std::thread ioThread;
+   std::atomic<bool> ioRunning {false};
+
+   // packets received by I/O thread, routed by message type
+   mutable std::mutex rxMutex;
+   mutable std::condition_variable rxSignal;
+   mutable PacketRing rxControl {PN7160_CONTROL_RING};
+   mutable PacketRing rxNotify {PN7160_NOTIFY_RING};
+   mutable PacketRing rxData {PN7160_DATA_RING};
+   unsigned long rxSequence = 0;
+
+   // responses of commands queued without waiting for them, dropped by I/O thread, guarded by receive lock
+   mutable unsigned int rxControlSkip = 0;
+
+   // raised when a notification or data packet is routed, guarded by receive lock
+   std::shared_ptr<rt::Waitable> rxWaitable;
+
+   // steady clock nanoseconds when IRQ of last packet read from bus was seen
+   mutable unsigned long long rxTime = 0;
+
+   // steady clock nanoseconds when IRQ of last event delivered to caller was seen
+   mutable unsigned long long rxEventTime = 0;
+
+   // packets pending to be sent by I/O thread
+   mutable std::mutex txMutex;
+   mutable std::condition_variable txSignal;
+   mutable PacketRing txQueue {PN7160_SEND_RING};
+
+   // data credits per logical connection, -1 if flow control is not used, guarded by send lock
+   mutable int txCredits[NCI_MAX_CONNECTIONS] {};
+
+   // data packets queued and already sent, and steady clock nanoseconds when last one was sent, guarded by send lock
+   mutable unsigned long txDataQueued = 0;
+   mutable unsigned long txDataSent = 0;
+   mutable unsigned long long txDataTime = 0;
+
+   // RF interface is activated, data can be sent over static RF connection
+   bool rfActive = false;
+
+   // maximum data packet payload of static RF connection, from RF interface activation
+   unsigned int rfMaxPayload = NCI_MAX_PAYLOAD;
+
+   // NCI RF state, updated by I/O thread from notifications and by caller from discovery commands
+   std::atomic<int> rfState {RF_STATE_IDLE};
+
+   // last discovery configuration, resumed without reconfiguration when NFCC goes back to idle
+   std::vector<DiscoveryMode> rfDiscoveryModes;
+
+   // last deactivation delivered to caller
+   mutable Deactivation rfDeactivation {-1, -1};
+
+   // last activation delivered to caller
+   mutable Activation rfActivation {};
+
+   // I/O thread buffers
+   rt::ByteBuffer ioRecv = rt::ByteBuffer(NCI_MAX_PACKET);
+   rt::ByteBuffer ioSend = rt::ByteBuffer(NCI_MAX_PACKET);
+
+   // last event delivered to caller
+   mutable rt::ByteBuffer eventBuffer = rt::ByteBuffer(NCI_MAX_PACKET);
+
+   // bus buffers reused between NCI packets
+   mutable rt::ByteBuffer txBuffer;
+   mutable rt::ByteBuffer rxRequest;
+   mutable rt::ByteBuffer rxHeader;
+   mutable rt::ByteBuffer rxPayload;
+
+   Impl(const Protocol protocol, const unsigned char addr) : protocol(protocol), i2cAddress(addr), readWindow(protocol == SPI ? PN7160_SPI_READ_WINDOW : 0),
+                                                             rxRequest({static_cast<unsigned char>(protocol == I2C ? (addr << 1) | 1 : 0xff)})
    {
    }
 
@@ -261,7 +456,21 @@ struct PN7160::Impl
    {
       close();
 
-      if (!mpsse.open(protocol == SPI ? MPSSE::SPI0 : MPSSE::I2C, protocol == SPI ? MPSSE::CLK_1MHZ : MPSSE::CLK_100KHZ))
+      Options options {
+         .clock = protocol == SPI ? PN7160_SPI_DEFAULT_CLOCK : PN7160_I2C_DEFAULT_CLOCK,
+         .probe = 0,
+         .transport = MPSSE::TRANSPORT_FTDI,
+         .channel = MPSSE::CHANNEL_A,
+      };
+
+      // parse configuration, as "device=<serial|#index> channel=<A|B> clock=<hz> probe[=<hz>] transport=<ftdi|usb>", clock probe is only run when requested
+      if (!parseConfig(config, options))
+         return false;
+
+      const unsigned int clock = options.clock;
+      const unsigned int probe = options.probe;
+
+      if (!mpsse.open(protocol == SPI ? MPSSE::SPI0 : MPSSE::I2C, clock, MPSSE::BYTEORDER_BIG_ENDIAN, options.transport, options.device, options.channel))
       {
          log->error("open failed: {}", {mpsse.errorString()});
          return false;
@@ -269,17 +478,23 @@ struct PN7160::Impl
 
       LOG_INFO(log, "{} initialized at {}Hz ({})", {mpsse.deviceName(), mpsse.getClock(), (protocol == SPI ? "SPI" : "I2C")});
 
-      // set DWL = 0 to disable DOWNLOAD mode
-      mpsse.setGpio(PN7160_FT232H_DWL_PIN, 0);
-      usleep(PN7160_T_WL_DWL);
+      // power on sequence, NFCC configuration is unknown from now
+      if (!powerCycle())
+      {
+         log->error("power cycle failed, VEN / DWL pins not available: {}", {mpsse.errorString()});
+         mpsse.close();
+         return false;
+      }
+
+      configCache.clear();
 
-      // trigger VEN low pulse to reset PN7160
-      mpsse.setGpio(PN7160_FT232H_VEN_PIN, 1);
-      usleep(PN7160_T_WL_VDD);
-      mpsse.setGpio(PN7160_FT232H_VEN_PIN, 0);
-      usleep(PN7160_T_WL_VEN);
-      mpsse.setGpio(PN7160_FT232H_VEN_PIN, 1);
-      usleep(PN7160_T_BOOT);
+      // step up bus clock while NFCC responds properly
+      if (probe > clock && !probeClock(probe))
+      {
+         log->error("clock probe failed");
+         mpsse.close();
+         return false;
+      }
 
       // execute initialization sequence
       while (true)
@@ -290,31 +505,24 @@ struct PN7160::Impl
             break;
          }
 
-         if (!nciSetConfig(NXP_CONF_CORE))
-         {
-            log->error("set NXP_CONF_CORE parameters failed");
-            return false;
-         }
-
-         if (!nciSetConfig(NXP_CONF_CORE_EXT))
-         {
-            log->error("set NXP_CONF_CORE_EXT parameters failed");
-            return false;
-         }
+         unsigned int changes = 0;
 
-         if (!nciSetConfig(NXP_CONF_TVDD))
+         // proprietary parameters are kept in NFCC non-volatile memory, readable ones are written only if they differ
+         if (!nciPersistentConfig(changes))
          {
-            log->error("set NXP_CONF_TVDD parameters failed");
-            return false;
+            log->error("set NXP persistent parameters failed");
+            break;
          }
 
-         if (!nciSetConfig(NXP_CONF_RF))
+         // core parameters have been reset to defaults
+         if (!nciSetConfig(NXP_CONF_CORE))
          {
-            log->error("set NXP_CONF_RF parameters failed");
-            return false;
+            log->error("set NXP_CONF_CORE parameters failed");
+            break;
          }
 
-         if (!coreReset(false))
+         // persistent parameters take effect after reset, not needed if NFCC already holds the readable ones
+         if (changes > 0 && !coreReset(false))
          {
             log->error("core reset failed");
             break;
@@ -331,6 +539,9 @@ struct PN7160::Impl
          device = mpsse.deviceName();
          status = STATUS_OPENED;
 
+         // from now on bus is only accessed by I/O thread
+         ioStart();
+
          return true;
       }
 
@@ -340,11 +551,200 @@ struct PN7160::Impl
       return false;
    }
 
+   /*
+    * parse open configuration string
+    */
+   bool parseConfig(const std::string &config, Options &options) const
+   {
+      std::istringstream input(config);
+      std::string option;
+
+      while (input >> option)
+      {
+         const auto sep = option.find('=');
+         const auto key = option.substr(0, sep);
+         const auto value = sep != std::string::npos ? option.substr(sep + 1) : std::string();
+
+         // bulk data path, libftdi or direct USB transfers
+         if (key == "transport")
+         {
+            if (value == "ftdi")
+               options.transport = MPSSE::TRANSPORT_FTDI;
+            else if (value == "usb")
+               options.transport = MPSSE::TRANSPORT_USB;
+            else
+            {
+               log->error("invalid config option {}", {option});
+               return false;
+            }
+
+            continue;
+         }
+
+         // bridge device, by serial number or enumeration index as #<index>
+         if (key == "device")
+         {
+            if (value.empty())
+            {
+               log->error("invalid config option {}", {option});
+               return false;
+            }
+
+            options.device = value;
+
+            continue;
+         }
+
+         // bridge channel, for dual channel FT2232H / FT4232H devices
+         if (key == "channel")
+         {
+            if (value == "A" || value == "a")
+               options.channel = MPSSE::CHANNEL_A;
+            else if (value == "B" || value == "b")
+               options.channel = MPSSE::CHANNEL_B;
+            else
+            {
+               log->error("invalid config option {}", {option});
+               return false;
+            }
+
+            continue;
+         }
+
+         // clock probe up to default limit, each probe step costs a CORE_RESET / CORE_INIT cycle on every open
+         if (key == "probe" && value.empty())
+         {
+            options.probe = protocol == SPI ? PN7160_SPI_PROBE_CLOCK : 0;
+
+            continue;
+         }
+
+         char *end = nullptr;
+
+         const unsigned long number = std::strtoul(value.c_str(), &end, 10);
+
+         if (value.empty() || *end != 0)
+         {
+            log->error("invalid config option {}", {option});
+            return false;
+         }
+
+         if (key == "clock")
+         {
+            options.clock = number;
+         }
+         else if (key == "probe")
+         {
+            options.probe = number;
+         }
+         else
+         {
+            log->error("unknown config option {}", {key});
+            return false;
+         }
+      }
+
+      if (protocol == SPI)
+      {
+         if (options.clock > PN7160_SPI_MAX_CLOCK)
+         {
+            log->warn("clock {}Hz exceeds maximum, limited to {}Hz", {options.clock, PN7160_SPI_MAX_CLOCK});
+            options.clock = PN7160_SPI_MAX_CLOCK;
+         }
+
+         if (options.probe > PN7160_SPI_MAX_CLOCK)
+         {
+            log->warn("probe clock {}Hz exceeds maximum, limited to {}Hz", {options.probe, PN7160_SPI_MAX_CLOCK});
+            options.probe = PN7160_SPI_MAX_CLOCK;
+         }
+      }
+
+      return true;
+   }
+
+   /*
+    * disable download mode and pulse VEN to reset PN7160, returns once NFCC has booted or false if pins can't be driven
+    */
+   bool powerCycle() const
+   {
+      // set DWL = 0 to disable DOWNLOAD mode, bridges without high byte GPIO (FT4232H) can't drive it
+      if (!mpsse.setGpio(PN7160_FT232H_DWL_PIN, 0))
+         return false;
+
+      // trigger VEN low pulse to reset PN7160
+      if (!mpsse.setGpio(PN7160_FT232H_VEN_PIN, 1) || !mpsse.setGpio(PN7160_FT232H_VEN_PIN, 0))
+         return false;
+
+      usleep(PN7160_T_WL_VEN);
+
+      if (!mpsse.setGpio(PN7160_FT232H_VEN_PIN, 1))
+         return false;
+
+      const auto start = std::chrono::steady_clock::now();
+
+      eventBuffer.clear();
+
+      // NFCC raises IRQ with CORE_RESET_NTF as soon as it has booted, otherwise it is ready once T-BOOT expires
+      if (nciRecv(eventBuffer, PN7160_T_BOOT))
+         LOG_DEBUG(log, "NFCC booted after {}us, notification: {x}", {std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(), eventBuffer});
+      else
+         LOG_DEBUG(log, "NFCC boot notification not received");
+
+      return true;
+   }
+
+   /*
+    * increase bus clock step by step up to limit, verifying CORE_RESET / CORE_INIT responses on each one
+    */
+   bool probeClock(const unsigned int limit) const
+   {
+      static const unsigned int steps[] = {MPSSE::CLK_2MHZ, MPSSE::CLK_5MHZ, MPSSE::CLK_6MHZ, MPSSE::CLK_10MHZ};
+
+      // first verify at initial clock
+      if (!coreReset(false))
+         return false;
+
+      unsigned int valid = mpsse.getClock();
+
+      for (const unsigned int step: steps)
+      {
+         const unsigned int next = std::min(step, limit);
+
+         if (next <= valid)
+            continue;
+
+         if (!mpsse.setClock(next))
+            return false;
+
+         // requested frequency not reachable without exceeding it
+         if (mpsse.getClock() <= valid)
+            break;
+
+         if (!coreReset(false))
+         {
+            log->warn("NFCC not responding at {}Hz, fallback to {}Hz", {mpsse.getClock(), valid});
+
+            // restore last valid clock and reset NFCC to discard partial transfers
+            if (!mpsse.setClock(valid) || !powerCycle())
+               return false;
+
+            break;
+         }
+
+         valid = mpsse.getClock();
+      }
+
+      LOG_INFO(log, "bus clock set to {}Hz", {mpsse.getClock()});
+
+      return true;
+   }
+
    /*
     * close communication context
     */
    void close()
    {
+      ioStop();
       mpsse.close();
       device = mpsse.deviceName();
       status = STATUS_CLOSED;
@@ -357,6 +757,9 @@ struct PN7160::Impl
    {
       log->info("start discovery in listen mode");
 
+      // events not taken from previous session would hold back responses of the commands below
+      nciDiscardEvents();
+
       /*
        * step 1, send CORE_SET_CONF_CMD
        */
@@ -423,6 +826,9 @@ struct PN7160::Impl
    {
       LOG_INFO(log, "start discovery in poll mode");
 
+      // events not taken from previous session would hold back responses of the commands below
+      nciDiscardEvents();
+
       /*
        * step 1, send CORE_SET_CONFIG_CMD
        */
@@ -467,104 +873,209 @@ struct PN7160::Impl
       return true;
    }
 
-   bool stopDiscoveryMode()
+   /*
+    * restart discovery after NFCC went back to idle, configuration, discovery map and routing are kept by NFCC
+    */
+   bool resumeDiscoveryMode()
    {
-      LOG_INFO(log, "stop discovery mode");
+      LOG_INFO(log, "resume discovery mode");
 
-      // enable RF discovery listen
-      if (!nciRfDiscoveryStop())
+      if (rfDiscoveryModes.empty())
       {
-         log->error("discovery stop failed");
+         log->error("discovery resume failed: discovery not started");
          return false;
       }
 
-      // update status
-      status = STATUS_OPENED;
+      // nothing to do if NFCC is still in discovery loop
+      if (rfState != RF_STATE_IDLE)
+         return true;
+
+      if (!nciRfDiscoveryStart(rfDiscoveryModes))
+      {
+         log->error("discovery resume failed");
+         return false;
+      }
 
       return true;
    }
 
    /*
-    * Wait to receive event
+    * change discovery parameters, if NFCC is in discovery loop it is stopped only when some value differs
     */
-   int waitEvent(rt::ByteBuffer &data, const int timeout) const
+   bool updateDiscoveryMode(const std::vector<Parameter> &parameters)
    {
-      LOG_DEBUG(log, "wait for event, timeout: {}ms", {timeout});
+      LOG_INFO(log, "update discovery parameters");
 
-      rt::ByteBuffer event(256);
+      std::vector<rt::ByteBuffer> list;
 
-      // read next message
-      if (!nciRecv(event, timeout))
-         return EVENT_TIMEOUT;
+      if (!nciConfigList(parameters, list))
+         return false;
 
-      const int mt = event.get() & 0xEF;
-      const int op = event.get() & 0x3F;
-      const int len = event.get();
+      const std::vector<rt::ByteBuffer> changed = nciChangedConfig(list);
 
-      // get message payload if any...
-      rt::ByteBuffer payload = event.getBuffer(len);
+      if (changed.empty())
+         return true;
 
-      // add payload to data
-      data.put(payload).flip();
+      // current values of changed parameters, set again if new ones are not accepted
+      std::vector<rt::ByteBuffer> previous;
 
-      // check message type
-      switch (mt)
+      for (const auto &parameter: changed)
       {
-         case NCI_MT_DATA:
-            return EVENT_DATA;
+         if (const auto it = configCache.find(nciConfigTag(parameter)); it != configCache.end())
+            previous.push_back(it->second);
+      }
 
-         case NCI_MT_EVENT_CORE:
-         {
-            if (op == NCI_OP_CORE_CONN_CREDITS_NTF)
-            {
-               LOG_DEBUG(log, "notify CORE_CONN_CREDITS_NTF");
+      // already idle, new values are used on next discovery start
+      if (rfState == RF_STATE_IDLE)
+      {
+         if (nciSetConfig(changed))
+            return true;
 
-               const int entries = payload.get();
+         log->error("discovery update failed: set core parameters");
 
-               for (int i = 0; i < entries; i++)
-               {
-                  LOG_DEBUG(log, "   connId:0x{02x}", {payload.get()});
-                  LOG_DEBUG(log, "   credits:0x{02x}", {payload.get()});
-               }
+         nciSetConfig(previous);
 
-               return EVENT_CREDITS;
-            }
+         return false;
+      }
 
-            return EVENT_UNKNOW;
+      // NFCC only accepts configuration in idle state
+      if (!nciRfDiscoveryStop())
+      {
+         log->error("discovery update failed: stop discovery");
+         return false;
+      }
+
+      if (!nciSetConfig(changed))
+      {
+         log->error("discovery update failed: set core parameters, resume discovery with previous ones");
+
+         // NFCC may hold part of new values
+         if (!nciSetConfig(previous))
+            log->error("previous parameters not restored");
+
+         if (!nciRfDiscoveryStart(rfDiscoveryModes))
+            log->error("discovery resume failed, NFCC is idle");
+
+         return false;
+      }
+
+      // discovery map and routing are kept by NFCC
+      if (!nciRfDiscoveryStart(rfDiscoveryModes))
+      {
+         log->error("discovery update failed: start discovery");
+         return false;
+      }
+
+      return true;
+   }
+
+   bool stopDiscoveryMode()
+   {
+      LOG_INFO(log, "stop discovery mode");
+
+      // enable RF discovery listen
+      if (!nciRfDiscoveryStop())
+      {
+         log->error("discovery stop failed");
+         return false;
+      }
+
+      // update status
+      status = STATUS_OPENED;
+
+      return true;
+   }
+
+   /*
+    * Wait to receive event
+    */
+   int waitEvent(rt::ByteBuffer &data, const int timeout) const
+   {
+      LOG_DEBUG(log, "wait for event, timeout: {}ms", {timeout});
+
+      rt::ByteBuffer &event = eventBuffer;
+
+      // get next notification or data packet in order of arrival
+      if (!nciEvent(event, timeout, rxEventTime))
+         return EVENT_TIMEOUT;
+
+      const int mt = event.get() & 0xEF;
+      const int op = event.get() & 0x3F;
+      const int len = event.get();
+
+      // message payload, parsed in place
+      rt::ByteBuffer &payload = event;
+
+      // add payload to data, caller buffer grows if needed
+      nciAppend(data, payload.ptr(), len);
+
+      // segmented data message, remaining packets are reassembled in order
+      if (mt == NCI_MT_DATA)
+      {
+         while (event[0] & NCI_PBF)
+         {
+            if (!nciTake(rxData, event, PN7160_DEFAULT_TIMEOUT))
+            {
+               log->error("nci data receive error: segmented message not completed");
+               data.clear();
+               return EVENT_TIMEOUT;
+            }
+
+            nciAppend(data, event.ptr() + 3, event[2]);
          }
+      }
 
-         case NCI_MT_EVENT_RF:
+      data.flip();
+
+      // check message type
+      switch (mt)
+      {
+         case NCI_MT_DATA:
+            return EVENT_DATA;
+
+         case NCI_MT_EVENT_CORE:
          {
-            if (op == NCI_OP_RF_INTF_ACTIVATED_NTF)
+            if (op == NCI_OP_CORE_CONN_CREDITS_NTF)
             {
-               LOG_DEBUG(log, "notify RF_INTF_ACTIVATED_NTF");
-               LOG_DEBUG(log, "   RF discovery ID:0x{02x}", {payload.get()});
-               LOG_DEBUG(log, "   RF interface:0x{02x}", {payload.get()});
-               LOG_DEBUG(log, "   RF protocol:0x{02x}", {payload.get()});
-               LOG_DEBUG(log, "   RF activation mode:0x{02x}", {payload.get()});
-               LOG_DEBUG(log, "   RF max payload size:{}", {payload.get()});
-               LOG_DEBUG(log, "   RF initial credits:{}", {payload.get()});
+               LOG_DEBUG(log, "notify CORE_CONN_CREDITS_NTF");
+
+               const int entries = payload.get();
 
-               unsigned int l = payload.get();
+               for (int i = 0; i < entries; i++)
+               {
+                  LOG_DEBUG(log, "   connId:0x{02x}", {payload.get()});
+                  LOG_DEBUG(log, "   credits:0x{02x}", {payload.get()});
+               }
 
-               if (l > 0)
-                  LOG_DEBUG(log, "   RF tech params:{x}", {payload.getBuffer(l)});
+               return EVENT_CREDITS;
+            }
 
-               LOG_DEBUG(log, "   RF exchange mode:0x{02x}", {payload.get()});
-               LOG_DEBUG(log, "   RF transmit bit rate:0x{02x}", {payload.get()});
-               LOG_DEBUG(log, "   RF receive bit rate:0x{02x}", {payload.get()});
+            return EVENT_UNKNOW;
+         }
 
-               l = payload.get();
+         case NCI_MT_EVENT_RF:
+         {
+            if (op == NCI_OP_RF_INTF_ACTIVATED_NTF)
+            {
+               // parsed once over caller buffer, no copies are made
+               if (!parseActivation(data, rfActivation))
+               {
+                  log->warn("invalid RF_INTF_ACTIVATED_NTF: {x}", {data});
+                  return EVENT_ACTIVATED;
+               }
 
-               if (l > 0)
-                  LOG_DEBUG(log, "   RF activation params:{x}", {payload.getBuffer(l)});
+               LOG_DEBUG(log, "notify RF_INTF_ACTIVATED_NTF, interface 0x{02x} protocol 0x{02x} mode 0x{02x} bit rate {}/{}", {rfActivation.interface, rfActivation.protocol, rfActivation.mode, rfActivation.txBitRate, rfActivation.rxBitRate});
 
                return EVENT_ACTIVATED;
             }
 
             if (op == NCI_OP_RF_DEACTIVATE_NTF)
             {
-               LOG_DEBUG(log, "notify RF_DEACTIVATE_NTF, type {} reason {}", {payload.get(), payload.get()});
+               rfDeactivation.type = len > 0 ? payload.get() : DEACTIVATE_IDLE;
+               rfDeactivation.reason = len > 1 ? payload.get() : DEACTIVATE_DH_REQUEST;
+
+               LOG_DEBUG(log, "notify RF_DEACTIVATE_NTF, type {} reason {}", {rfDeactivation.type, rfDeactivation.reason});
+
                return EVENT_DEACTIVATED;
             }
 
@@ -582,6 +1093,45 @@ struct PN7160::Impl
       }
    }
 
+   /*
+    * parse RF_INTF_ACTIVATED_NTF payload, parameters are views over payload buffer
+    */
+   static bool parseActivation(const rt::ByteBuffer &payload, Activation &activation)
+   {
+      const unsigned int base = payload.position();
+      const unsigned int length = payload.remaining();
+
+      // fixed fields up to RF technology specific parameters length
+      if (length < 7)
+         return false;
+
+      const unsigned int techLength = payload[base + 6];
+
+      // data exchange mode, bit rates and activation parameters length
+      if (length < 7 + techLength + 4)
+         return false;
+
+      const unsigned int exchange = base + 7 + techLength;
+      const unsigned int paramsLength = payload[exchange + 3];
+
+      if (length < 7 + techLength + 4 + paramsLength)
+         return false;
+
+      activation.discoveryId = payload[base];
+      activation.interface = payload[base + 1];
+      activation.protocol = payload[base + 2];
+      activation.mode = payload[base + 3];
+      activation.maxPayload = payload[base + 4];
+      activation.credits = payload[base + 5];
+      activation.techParams = payload.slice(base + 7, techLength);
+      activation.exchangeMode = payload[exchange];
+      activation.txBitRate = payload[exchange + 1];
+      activation.rxBitRate = payload[exchange + 2];
+      activation.activationParams = payload.slice(exchange + 4, paramsLength);
+
+      return true;
+   }
+
    /*
     * Wait to receive data message, skip other events
     */
@@ -620,27 +1170,162 @@ struct PN7160::Impl
    }
 
    /*
-    * Send data
+    * Send data, message is segmented in packets queued for I/O thread, each one consumes a credit
     */
-   bool sendData(const rt::ByteBuffer &data) const
+   bool sendData(const rt::ByteBuffer &data, const int timeout) const
    {
       LOG_DEBUG(log, "send data: {x}", {data});
 
-      rt::ByteBuffer cmd(256);
-
-      // build set config command
-      cmd.put(NCI_DATA_CMD).put(data.elements()).put(data).flip();
-
-      // send control command
-      if (!nciSend(cmd))
+      if (!ioRunning)
       {
-         log->error("nci data send error");
+         log->error("nci data send error: device not open");
          return false;
       }
 
+      const unsigned int length = data.remaining();
+
+      // whole message must be queued within timeout
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+      std::unique_lock lock(txMutex);
+
+      int &credits = txCredits[NCI_CONN_STATIC_RF];
+
+      // room for all segments is reserved in send queue before first one is queued, if they fit in it
+      const unsigned int segments = std::max((length + rfMaxPayload - 1) / rfMaxPayload, 1u);
+
+      unsigned int room = std::min(segments, static_cast<unsigned int>(PN7160_SEND_RING));
+
+      // wait for a credit and room in send queue, several packets can be in flight while credits permit
+      const auto ready = [&] { return !rfActive || !ioRunning || (credits != 0 && txQueue.available() >= room); };
+
+      unsigned int offset = 0;
+
+      do
+      {
+         if (timeout < 0)
+            txSignal.wait(lock, ready);
+         else if (!txSignal.wait_until(lock, deadline, ready))
+         {
+            log->error("nci data send error: {}, {} of {} bytes queued", {credits == 0 ? "no credits available" : "send queue full", offset, length});
+
+            // segments already queued announce more data, NFCC would wait forever for the rest of message
+            if (offset > 0)
+            {
+               lock.unlock();
+               nciRfAbort();
+            }
+
+            return false;
+         }
+
+         room = 1;
+
+         if (!rfActive || !ioRunning)
+         {
+            log->error("nci data send error: RF interface not active");
+            return false;
+         }
+
+         // credit is consumed when packet is queued, I/O thread sends all queued packets
+         if (credits > 0)
+            credits--;
+
+         const unsigned int size = std::min(length - offset, rfMaxPayload);
+
+         // all segments except last one are flagged with packet boundary flag
+         const unsigned char header = NCI_DATA_CMD[0] | (offset + size < length ? NCI_PBF : 0);
+
+         // build data packet directly in send queue
+         txQueue.push().packet.put(header).put(NCI_DATA_CMD[1]).put(size).put(data.ptr() + offset, size).flip();
+
+         txDataQueued++;
+
+         offset += size;
+
+         txSignal.notify_all();
+
+      } while (offset < length);
+
       return true;
    }
 
+   /*
+    * deactivate RF interface back to discovery, so NFCC discards incomplete data message and reader sees link loss
+    */
+   void nciRfAbort() const
+   {
+      log->warn("deactivate RF interface to discard incomplete data message");
+
+      const rt::ByteBuffer cmd {NCI_RF_DEACTIVATE_CMD[0], NCI_RF_DEACTIVATE_CMD[1], 0x01, DEACTIVATE_DISCOVERY};
+
+      std::unique_lock lock(txMutex);
+
+      if (!txSignal.wait_for(lock, std::chrono::milliseconds(PN7160_DEFAULT_TIMEOUT), [this] { return !txQueue.full() || !ioRunning; }) || !ioRunning)
+      {
+         log->error("RF deactivation failed: send queue full");
+         return;
+      }
+
+      // response is not waited, caller may not be the one waiting for control responses
+      {
+         std::lock_guard rxLock(rxMutex);
+         rxControlSkip++;
+      }
+
+      txQueue.push().packet.put(cmd).flip();
+
+      txSignal.notify_all();
+   }
+
+   /*
+    * wait until all queued data packets are transferred, returns steady clock nanoseconds when last one was completed
+    * or failed, 0 on timeout; timeout 0 only polls
+    */
+   unsigned long long sendTime(const int timeout) const
+   {
+      std::unique_lock lock(txMutex);
+
+      const auto sent = [this] { return txDataSent >= txDataQueued || !ioRunning; };
+
+      if (timeout < 0)
+         txSignal.wait(lock, sent);
+      else if (!txSignal.wait_for(lock, std::chrono::milliseconds(timeout), sent))
+         return 0;
+
+      return txDataSent >= txDataQueued ? txDataTime : 0;
+   }
+
+   /*
+    * data packet transfer completed or failed, called from bus completion so queued and sent counters match once
+    * send queue is drained
+    */
+   void ioSent() const
+   {
+      const unsigned long long time = steadyTime();
+
+      {
+         std::lock_guard lock(txMutex);
+
+         txDataSent++;
+         txDataTime = time;
+      }
+
+      txSignal.notify_all();
+
+      // caller is not waiting for transfer, wake it so it can stamp sent data
+      if (rxWaitable)
+         rxWaitable->notify();
+   }
+
+   /*
+    * current steady clock time, in nanoseconds
+    */
+   static unsigned long long steadyTime()
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+   }
+
    /*
     * perform reset procedure of PN7160
     */
@@ -655,6 +1340,10 @@ struct PN7160::Impl
          return false;
       }
 
+      // NFCC is back to its default configuration
+      if (resetConfig)
+         configCache.clear();
+
       // init to apply configuration
       if (!nciCoreInit())
       {
@@ -687,7 +1376,7 @@ struct PN7160::Impl
       for (const auto &[tag, value]: parameters)
       {
          // add TAG id, 2 byte extended
-         if (tag & 0xA000)
+         if (tag > 0xFF)
             payload.putInt(tag, 2, rt::ByteBuffer::BigEndian);
 
             // add TAG id, 1 byte
@@ -718,7 +1407,7 @@ struct PN7160::Impl
          unsigned int tag = rsp.get();
 
          // get tag id (extended)
-         if ((tag & 0xA0) == 0xA0)
+         if (nciExtendedTag(tag))
             tag = (tag << 8) | rsp.get();
 
          // get tag length
@@ -760,6 +1449,17 @@ struct PN7160::Impl
       // build parameters payload
       std::vector<rt::ByteBuffer> list;
 
+      if (!nciConfigList(parameters, list))
+         return false;
+
+      return nciUpdateConfig(list);
+   }
+
+   /*
+    * build configuration TLV for each parameter
+    */
+   bool nciConfigList(const std::vector<Parameter> &parameters, std::vector<rt::ByteBuffer> &list) const
+   {
       for (const auto &[tag, value]: parameters)
       {
          LOG_DEBUG(log, "   [{02x}]: {x}", {tag, value});
@@ -773,7 +1473,7 @@ struct PN7160::Impl
          rt::ByteBuffer entry(255);
 
          // add TAG id, 2 byte extended / 1 byte
-         if (tag & 0xA000)
+         if (tag > 0xFF)
             entry.putInt(tag, 2, rt::ByteBuffer::BigEndian);
          else
             entry.putInt(tag, 1);
@@ -785,7 +1485,7 @@ struct PN7160::Impl
          list.push_back(entry);
       }
 
-      return nciSetConfig(list);
+      return true;
    }
 
    // bool selfTest()
@@ -830,6 +1530,9 @@ struct PN7160::Impl
       // prepare NCI_CORE_RESET_CMD
       cmd.put(NCI_CORE_RESET_CMD).put(0x01).put(resetConfig ? 1 : 0).flip();
 
+      // notifications before reset are meaningless
+      nciDiscardEvents();
+
       if (!nciControl(cmd, rsp))
       {
          log->error("send NCI_CORE_RESET_CMD failed");
@@ -839,7 +1542,7 @@ struct PN7160::Impl
       rsp.clear();
 
       // read NCI_CORE_RESET_NFT
-      if (!nciRecv(rsp, 1000))
+      if (!(ioRunning ? nciTake(rxNotify, rsp, 1000) : nciRecv(rsp, 1000)))
       {
          log->error("read NCI_CORE_RESET_NTF failed");
          return false;
@@ -915,99 +1618,330 @@ struct PN7160::Impl
    }
 
    /*
-    * NCI_CORE_SET_CONF_CMD command
+    * NCI_CORE_SET_CONF_CMD command, parameters TLVs are packed in as few commands as possible
     */
    bool nciSetConfig(const std::vector<rt::ByteBuffer> &parameters) const
    {
-      LOG_DEBUG(log, "send NCI_CORE_SET_CONF_CMD");
-
       if (parameters.empty())
       {
          LOG_DEBUG(log, "not parameters to set!");
          return true;
       }
 
-      rt::ByteBuffer cmd(256);
-      rt::ByteBuffer rsp(256);
-      rt::ByteBuffer data(256);
+      rt::ByteBuffer cmd(NCI_MAX_PACKET);
+      rt::ByteBuffer rsp(NCI_MAX_PACKET);
+      rt::ByteBuffer data(NCI_MAX_PAYLOAD);
 
-      data.put(parameters.size());
+      auto next = parameters.begin();
 
-      for (const auto &parameter: parameters)
-         data.put(parameter);
+      while (next != parameters.end())
+      {
+         const auto first = next;
 
-      data.flip();
+         // first byte is number of parameters, updated once command is full
+         data.clear().put(0);
 
-      // build set config command
-      cmd.put(NCI_CORE_SET_CONF_CMD).put(data.elements()).put(data).flip();
+         while (next != parameters.end() && next->remaining() <= data.remaining())
+            data.put(*next++);
 
-      // send control command
-      if (!nciControl(cmd, rsp))
-         return false;
+         if (next == first)
+         {
+            log->error("parameter of {} bytes exceeds command size", {next->remaining()});
+            return false;
+         }
 
-      return true;
-   }
+         const int count = static_cast<int>(next - first);
 
-   /*
-    * NCI_CORE_SET_POWER_MODE_CMD command
-    */
-   bool nciSetPowerMode(unsigned int mode) const
-   {
-      LOG_DEBUG(log, "send NCI_CORE_SET_POWER_MODE_CMD");
+         data[0] = static_cast<unsigned char>(count);
+         data.flip();
 
-      // build parameters payload
-      rt::ByteBuffer payload({static_cast<unsigned char>(mode)});
-      rt::ByteBuffer cmd(256);
-      rt::ByteBuffer rsp(256);
+         LOG_DEBUG(log, "send NCI_CORE_SET_CONF_CMD, {} parameters", {count});
 
-      // build set config command
-      cmd.put(NCI_CORE_SET_POWER_MODE_CMD).put(payload.elements()).put(payload).flip();
+         // build set config command
+         cmd.clear().put(NCI_CORE_SET_CONF_CMD).put(data.elements()).put(data).flip();
 
-      // send control command
-      if (!nciControl(cmd, rsp))
-         return false;
+         // send control command, on error NFCC may have accepted some of these values so they are unknown
+         if (!nciControl(cmd, rsp))
+         {
+            for (auto it = first; it != next; ++it)
+               configCache.erase(nciConfigTag(*it));
+
+            return false;
+         }
+
+         // now NFCC holds these values
+         for (auto it = first; it != next; ++it)
+            configCache[nciConfigTag(*it)] = *it;
+      }
 
       return true;
    }
 
    /*
-    * NCI_RF_DISCOVER_CMD command
+    * NCI_CORE_GET_CONF_CMD command, reads current values of parameters TLVs into configuration cache
     */
-   bool nciRfDiscoveryStart(const std::vector<DiscoveryMode> &discoveryModes)
+   bool nciGetConfig(const std::vector<rt::ByteBuffer> &parameters) const
    {
-      LOG_DEBUG(log, "send NCI_RF_DISCOVER_CMD");
-
-      // build parameters payload
-      rt::ByteBuffer payload(256);
+      rt::ByteBuffer cmd(NCI_MAX_PACKET);
+      rt::ByteBuffer rsp(NCI_MAX_PACKET);
+      rt::ByteBuffer data(NCI_MAX_PAYLOAD);
+      rt::ByteBuffer message(NCI_MAX_PACKET);
 
-      // number of discovery configurations
-      payload.put(discoveryModes.size());
+      auto next = parameters.begin();
 
-      // add discovery tech modes
-      for (const auto &[m, p]: discoveryModes)
+      while (next != parameters.end())
       {
-         LOG_DEBUG(log, "   mode:0x{02x}, period:0x{02x}", {m, p});
-         payload.put(m).put(p);
-      }
+         const auto first = next;
 
-      payload.flip();
+         // response carries status and number of parameters, followed by its values
+         unsigned int expected = 2;
 
-      rt::ByteBuffer cmd(256);
-      rt::ByteBuffer rsp(256);
+         data.clear().put(0);
 
-      // build set config command
-      cmd.put(NCI_RF_DISCOVER_CMD).put(payload.elements()).put(payload).flip();
+         while (next != parameters.end() && expected + next->remaining() <= NCI_MAX_PAYLOAD)
+         {
+            const unsigned int tag = nciConfigTag(*next);
 
-      // send control command
-      if (!nciControl(cmd, rsp))
-         return false;
+            if (tag > 0xFF)
+               data.putInt(tag, 2, rt::ByteBuffer::BigEndian);
+            else
+               data.putInt(tag, 1);
 
-      return true;
-   }
+            expected += (next++)->remaining();
+         }
 
-   /*
-    * NCI_RF_DEACTIVATE_CMD command
-    */
+         if (next == first)
+            return false;
+
+         const int count = static_cast<int>(next - first);
+
+         data[0] = static_cast<unsigned char>(count);
+         data.flip();
+
+         LOG_DEBUG(log, "send NCI_CORE_GET_CONF_CMD, {} parameters", {count});
+
+         // build get config command
+         cmd.clear().put(NCI_CORE_GET_CONF_CMD).put(data.elements()).put(data).flip();
+
+         // send control command
+         if (!nciControl(cmd, rsp))
+            return false;
+
+         // values held by NFCC may be longer than requested ones, so response may be segmented and is reassembled first
+         message.clear();
+
+         nciAppend(message, rsp.data() + 3, rsp[2]);
+
+         while (rsp[0] & NCI_PBF)
+         {
+            rsp.clear();
+
+            if (!(ioRunning ? nciTake(rxControl, rsp, PN7160_DEFAULT_TIMEOUT) : nciRecv(rsp, PN7160_DEFAULT_TIMEOUT)))
+            {
+               log->error("nci control recv error: segmented response not completed");
+               return false;
+            }
+
+            nciAppend(message, rsp.data() + 3, rsp[2]);
+         }
+
+         message.flip();
+
+         // skip status
+         message.skip(1);
+
+         const unsigned int num = message.getInt(1);
+
+         // store received TLVs as they are, each one with its own length, so they can be compared with the ones to set
+         for (unsigned int i = 0; i < num && message.remaining() > 0; i++)
+         {
+            const unsigned int tagSize = nciExtendedTag(message[message.position()]) ? 2 : 1;
+
+            if (message.remaining() < tagSize + 1)
+               break;
+
+            const unsigned int size = tagSize + 1 + message[message.position() + tagSize];
+
+            if (message.remaining() < size)
+               break;
+
+            rt::ByteBuffer entry = message.getBuffer(size);
+
+            configCache[nciConfigTag(entry)] = entry;
+         }
+      }
+
+      return true;
+   }
+
+   /*
+    * set only parameters whose value differs from the one held by NFCC, unknown values are read first
+    */
+   bool nciUpdateConfig(const std::vector<rt::ByteBuffer> &parameters, unsigned int *changes = nullptr) const
+   {
+      const std::vector<rt::ByteBuffer> changed = nciChangedConfig(parameters);
+
+      if (changes)
+         *changes += changed.size();
+
+      return nciSetConfig(changed);
+   }
+
+   /*
+    * get parameters whose value differs from the one held by NFCC, unknown values are read first
+    */
+   std::vector<rt::ByteBuffer> nciChangedConfig(const std::vector<rt::ByteBuffer> &parameters) const
+   {
+      std::map<unsigned int, int> occurrences;
+
+      for (const auto &parameter: parameters)
+         occurrences[nciConfigTag(parameter)]++;
+
+      // repeated tags are indirect writes (registers, etc.), they can't be compared and are always sent
+      std::vector<rt::ByteBuffer> unknown;
+
+      for (const auto &parameter: parameters)
+      {
+         const unsigned int tag = nciConfigTag(parameter);
+
+         if (occurrences[tag] == 1 && !configCache.count(tag))
+            unknown.push_back(parameter);
+      }
+
+      // if current values can't be read they are simply sent again
+      if (!unknown.empty() && !nciGetConfig(unknown))
+         LOG_DEBUG(log, "current configuration not available, all parameters are sent");
+
+      std::vector<rt::ByteBuffer> changed;
+
+      for (const auto &parameter: parameters)
+      {
+         const unsigned int tag = nciConfigTag(parameter);
+
+         if (occurrences[tag] > 1 || !configCache.count(tag) || configCache[tag] != parameter)
+            changed.push_back(parameter);
+      }
+
+      LOG_DEBUG(log, "{} of {} parameters changed", {changed.size(), parameters.size()});
+
+      return changed;
+   }
+
+   /*
+    * set NXP proprietary parameters stored in NFCC non-volatile memory, number of readable parameters that differed
+    * from NFCC values is added to changes, register writes are not counted as they can't be compared
+    */
+   bool nciPersistentConfig(unsigned int &changes) const
+   {
+      std::vector<rt::ByteBuffer> parameters;
+      std::vector<rt::ByteBuffer> registers;
+
+      std::map<unsigned int, int> occurrences;
+
+      for (const auto *group: {&NXP_CONF_CORE_EXT, &NXP_CONF_TVDD, &NXP_CONF_RF})
+      {
+         for (const auto &parameter: *group)
+            occurrences[nciConfigTag(parameter)]++;
+      }
+
+      // repeated tags are register writes, they can't be read back
+      for (const auto *group: {&NXP_CONF_CORE_EXT, &NXP_CONF_TVDD, &NXP_CONF_RF})
+      {
+         for (const auto &parameter: *group)
+            (occurrences[nciConfigTag(parameter)] > 1 ? registers : parameters).push_back(parameter);
+      }
+
+      // register writes can't be verified and bridge identity doesn't identify attached NFCC, so they are always sent;
+      // they are written with the same values on every open, so an NFCC already holding the readable parameters of
+      // this configuration holds them too and rewriting them alone does not require a reset
+      if (!registers.empty() && !nciSetConfig(registers))
+         return false;
+
+      // remaining parameters are compared with the values held by NFCC
+      return nciUpdateConfig(parameters, &changes);
+   }
+
+   /*
+    * get tag of configuration TLV, 2 bytes for extended (proprietary) tags
+    */
+   static unsigned int nciConfigTag(const rt::ByteBuffer &entry)
+   {
+      const unsigned char *p = entry.ptr();
+
+      return nciExtendedTag(p[0]) ? (p[0] << 8 | p[1]) : p[0];
+   }
+
+   /*
+    * first byte of configuration tag is one of the extension prefixes, NCI proprietary 0xA0 or NXP 0xA1
+    */
+   static bool nciExtendedTag(const unsigned int first)
+   {
+      return first == 0xA0 || first == 0xA1;
+   }
+
+   /*
+    * NCI_CORE_SET_POWER_MODE_CMD command
+    */
+   bool nciSetPowerMode(unsigned int mode) const
+   {
+      LOG_DEBUG(log, "send NCI_CORE_SET_POWER_MODE_CMD");
+
+      // build parameters payload
+      rt::ByteBuffer payload({static_cast<unsigned char>(mode)});
+      rt::ByteBuffer cmd(256);
+      rt::ByteBuffer rsp(256);
+
+      // build set config command
+      cmd.put(NCI_CORE_SET_POWER_MODE_CMD).put(payload.elements()).put(payload).flip();
+
+      // send control command
+      if (!nciControl(cmd, rsp))
+         return false;
+
+      return true;
+   }
+
+   /*
+    * NCI_RF_DISCOVER_CMD command
+    */
+   bool nciRfDiscoveryStart(const std::vector<DiscoveryMode> &discoveryModes)
+   {
+      LOG_DEBUG(log, "send NCI_RF_DISCOVER_CMD");
+
+      // build parameters payload
+      rt::ByteBuffer payload(256);
+
+      // number of discovery configurations
+      payload.put(discoveryModes.size());
+
+      // add discovery tech modes
+      for (const auto &[m, p]: discoveryModes)
+      {
+         LOG_DEBUG(log, "   mode:0x{02x}, period:0x{02x}", {m, p});
+         payload.put(m).put(p);
+      }
+
+      payload.flip();
+
+      rt::ByteBuffer cmd(256);
+      rt::ByteBuffer rsp(256);
+
+      // build set config command
+      cmd.put(NCI_RF_DISCOVER_CMD).put(payload.elements()).put(payload).flip();
+
+      // send control command
+      if (!nciControl(cmd, rsp))
+         return false;
+
+      rfDiscoveryModes = discoveryModes;
+      rfState = RF_STATE_DISCOVERY;
+
+      return true;
+   }
+
+   /*
+    * NCI_RF_DEACTIVATE_CMD command
+    */
    bool nciRfDiscoveryStop()
    {
       LOG_DEBUG(log, "send NCI_RF_DEACTIVATE_CMD");
@@ -1016,12 +1950,14 @@ struct PN7160::Impl
       rt::ByteBuffer rsp(256);
 
       // build set config command
-      cmd.put(NCI_RF_DEACTIVATE_CMD).put(0x01).put(0x00).flip();
+      cmd.put(NCI_RF_DEACTIVATE_CMD).put(0x01).put(DEACTIVATE_IDLE).flip();
 
       // send control command
       if (!nciControl(cmd, rsp))
          return false;
 
+      rfState = RF_STATE_IDLE;
+
       return true;
    }
 
@@ -1101,18 +2037,44 @@ struct PN7160::Impl
     */
    bool nciControl(const rt::ByteBuffer &cmd, rt::ByteBuffer &rsp) const
    {
-      // send control command
-      if (!nciSend(cmd))
+      // once I/O thread is running, command is sent by it and response is routed to control ring
+      if (ioRunning)
       {
-         log->error("nci control send error");
-         return false;
-      }
+         // discard late responses of previous commands, I/O thread may be waiting for room to route them
+         {
+            std::lock_guard lock(rxMutex);
+            rxControl.clear();
+         }
+
+         rxSignal.notify_all();
 
-      // read control response
-      if (!nciRecv(rsp, PN7160_DEFAULT_TIMEOUT))
+         if (!nciQueue(cmd))
+         {
+            log->error("nci control send error");
+            return false;
+         }
+
+         if (!nciTake(rxControl, rsp, PN7160_DEFAULT_TIMEOUT))
+         {
+            log->error("nci control recv error");
+            return false;
+         }
+      }
+      else
       {
-         log->error("nci control recv error");
-         return false;
+         // send control command
+         if (!nciSend(cmd))
+         {
+            log->error("nci control send error");
+            return false;
+         }
+
+         // read control response
+         if (!nciRecv(rsp, PN7160_DEFAULT_TIMEOUT))
+         {
+            log->error("nci control recv error");
+            return false;
+         }
       }
 
       // check response status
@@ -1126,49 +2088,467 @@ struct PN7160::Impl
    }
 
    /*
-    * NCI generic send command
+    * queue packet to be sent by I/O thread
     */
-   bool nciSend(const rt::ByteBuffer &cmd) const
+   bool nciQueue(const rt::ByteBuffer &packet) const
    {
-      const unsigned char target = protocol == I2C ? static_cast<char>(i2cAddress << 1) : 0x00;
+      std::lock_guard lock(txMutex);
+
+      if (txQueue.full())
+      {
+         log->error("nciQueue failed: send queue full");
+         return false;
+      }
 
-      rt::ByteBuffer buffer(1 + cmd.elements());
+      txQueue.push().packet.put(packet).flip();
 
-      // prepare TX buffer, first byte I2C address or direction byte for SPI
-      buffer.put(target).put(cmd).flip();
+      txSignal.notify_all();
 
-      LOG_TRACE(log, "TX: {x}", {cmd});
+      return true;
+   }
+
+   /*
+    * discard notifications and data not taken by caller, I/O thread may be waiting for room to route next packet
+    */
+   void nciDiscardEvents() const
+   {
+      if (!ioRunning)
+         return;
 
-      // set START condition
-      if (!mpsse.start())
       {
-         log->error("nciSend start failed: {}", {mpsse.errorString()});
+         std::lock_guard lock(rxMutex);
+         rxNotify.clear();
+         rxData.clear();
+      }
+
+      rxSignal.notify_all();
+   }
+
+   /*
+    * get next packet routed to ring by I/O thread, waits up to timeout milliseconds, or forever if negative
+    */
+   bool nciTake(PacketRing &ring, rt::ByteBuffer &packet, const int timeout) const
+   {
+      std::unique_lock lock(rxMutex);
+
+      if (!rxWait(lock, [&ring] { return !ring.empty(); }, timeout))
          return false;
+
+      return nciCopy(ring, packet);
+   }
+
+   /*
+    * get next notification or data packet, in order of arrival
+    */
+   bool nciEvent(rt::ByteBuffer &packet, const int timeout, unsigned long long &time) const
+   {
+      // device not initialized yet, read bus directly
+      if (!ioRunning)
+      {
+         packet.clear();
+
+         if (!nciRecv(packet, timeout))
+            return false;
+
+         time = rxTime;
+
+         return true;
       }
 
+      std::unique_lock lock(rxMutex);
+
+      if (!rxWait(lock, [this] { return !rxNotify.empty() || !rxData.empty(); }, timeout))
+         return false;
+
+      PacketRing &ring = rxData.empty() || (!rxNotify.empty() && rxNotify.front().sequence < rxData.front().sequence) ? rxNotify : rxData;
+
+      time = ring.front().time;
+
+      return nciCopy(ring, packet);
+   }
+
+   /*
+    * wait on receive rings until condition is met, or timeout expires
+    */
+   template <typename P>
+   bool rxWait(std::unique_lock<std::mutex> &lock, P condition, const int timeout) const
+   {
+      if (timeout < 0)
       {
-         // set STOP condition
-         rt::Finally stop([&] { mpsse.stop(); });
+         rxSignal.wait(lock, condition);
+         return true;
+      }
 
-         // send data
-         if (!mpsse.write(buffer))
+      return rxSignal.wait_for(lock, std::chrono::milliseconds(timeout), condition);
+   }
+
+   /*
+    * copy and release front packet of ring, guarded by receive lock
+    */
+   bool nciCopy(PacketRing &ring, rt::ByteBuffer &packet) const
+   {
+      const rt::ByteBuffer &front = ring.front().packet;
+
+      packet.clear();
+
+      if (packet.capacity() < front.remaining())
+      {
+         log->error("nci receive failed: buffer capacity {} is less than required {}", {packet.capacity(), front.remaining()});
+         ring.pop();
+         return false;
+      }
+
+      packet.put(front).flip();
+
+      ring.pop();
+
+      // I/O thread may be waiting for room in data ring
+      rxSignal.notify_all();
+
+      return true;
+   }
+
+   /*
+    * append bytes to buffer in write mode, buffer is reallocated when its capacity is not enough
+    */
+   static void nciAppend(rt::ByteBuffer &buffer, const unsigned char *data, const unsigned int length)
+   {
+      if (buffer.remaining() < length)
+      {
+         rt::ByteBuffer grown(std::max(buffer.capacity() * 2, buffer.position() + length));
+
+         grown.put(buffer.data(), buffer.position());
+
+         buffer = grown;
+      }
+
+      buffer.put(data, length);
+   }
+
+   /*
+    * start NCI I/O thread
+    */
+   void ioStart()
+   {
+      rxControl.clear();
+      rxNotify.clear();
+      rxData.clear();
+      rxControlSkip = 0;
+      txQueue.clear();
+
+      std::fill_n(txCredits, NCI_MAX_CONNECTIONS, 0);
+      rfActive = false;
+      rfState = RF_STATE_IDLE;
+
+      txDataQueued = 0;
+      txDataSent = 0;
+
+      ioRunning = true;
+      ioThread = std::thread([this] { ioLoop(); });
+   }
+
+   /*
+    * stop NCI I/O thread, bus is released to caller thread
+    */
+   void ioStop()
+   {
+      if (!ioThread.joinable())
+         return;
+
+      {
+         std::lock_guard lock(txMutex);
+         ioRunning = false;
+      }
+
+      txSignal.notify_all();
+      rxSignal.notify_all();
+      ioThread.join();
+   }
+
+   /*
+    * NCI I/O thread, sends queued packets and routes received packets as soon as IRQ is raised
+    */
+   void ioLoop()
+   {
+      LOG_INFO(log, "NCI I/O thread started");
+
+      while (ioRunning)
+      {
+         // send all queued packets in order
+         ioFlush();
+
+         // never arm IRQ wait with packets queued, so sends do not abort it on the hot path
+         if (!ioIdle())
+            continue;
+
+         ioRecv.clear();
+
+         // wait for IRQ and read header in short slices, packets queued while idle abort armed batch, header bytes
+         // already clocked out at that point are kept by MPSSE and returned by the next call, so nothing is lost
+         if (!nciRecv(ioRecv, PN7160_IO_SLICE))
          {
-            log->error("nciSend data failed: {}", {mpsse.errorString()});
-            return false;
+            // bus error, avoid spinning
+            if (!mpsse.isPending())
+               usleep(PN7160_IO_SLICE * 1000);
+
+            continue;
+         }
+
+         const int mt = ioRoute(ioRecv);
+
+         // responses and data are answered by caller, give it time to queue next packet before arming next IRQ wait
+         if (mt == NCI_MT_RESPONSE || (mt == NCI_MT_DATA && !(ioRecv[0] & NCI_PBF)))
+         {
+            std::unique_lock lock(txMutex);
+
+            txSignal.wait_for(lock, std::chrono::milliseconds(mt == NCI_MT_DATA ? PN7160_IO_RESPONSE : PN7160_IO_TURNAROUND), [this] { return !txQueue.empty() || !ioRunning; });
          }
       }
 
+      LOG_INFO(log, "NCI I/O thread finished");
+   }
+
+   /*
+    * check if there are no packets waiting to be sent
+    */
+   bool ioIdle() const
+   {
+      std::lock_guard lock(txMutex);
+
+      return txQueue.empty();
+   }
+
+   /*
+    * send all queued packets in order
+    */
+   void ioFlush()
+   {
+      while (ioNext(ioSend))
+      {
+         if (!nciSend(ioSend, (ioSend[0] & NCI_MT_MASK) == NCI_MT_DATA))
+            log->error("nci packet send error");
+      }
+   }
+
+   /*
+    * get next packet to send
+    */
+   bool ioNext(rt::ByteBuffer &packet) const
+   {
+      std::lock_guard lock(txMutex);
+
+      if (txQueue.empty())
+         return false;
+
+      packet.clear();
+      packet.put(txQueue.front().packet).flip();
+
+      txQueue.pop();
+
       return true;
    }
 
+   /*
+    * update data flow control and RF state from activation, deactivation, reset and credit notifications
+    */
+   void ioNotify(const rt::ByteBuffer &packet)
+   {
+      const int mt = packet[0] & 0xEF;
+      const int op = packet[1] & 0x3F;
+      const int len = packet[2];
+
+      std::lock_guard lock(txMutex);
+
+      if (mt == NCI_MT_EVENT_CORE && op == NCI_OP_CORE_CONN_CREDITS_NTF && len > 0)
+      {
+         const int entries = packet[3];
+
+         for (int i = 0; i < entries && 5 + i * 2 < 3 + len; i++)
+         {
+            const int conn = packet[4 + i * 2] & 0x0F;
+            const int count = packet[5 + i * 2];
+
+            if (txCredits[conn] >= 0)
+               txCredits[conn] = std::min(txCredits[conn] + count, 0xFE);
+
+            LOG_TRACE(log, "connection {} credits {}", {conn, txCredits[conn]});
+         }
+      }
+      else if (mt == NCI_MT_EVENT_RF && op == NCI_OP_RF_INTF_ACTIVATED_NTF && len > 5)
+      {
+         const int maxPayload = packet[3 + 4];
+         const int initial = packet[3 + 5];
+
+         txCredits[NCI_CONN_STATIC_RF] = initial == NCI_CREDITS_UNLIMITED ? -1 : initial;
+         rfMaxPayload = maxPayload > 0 ? maxPayload : NCI_MAX_PAYLOAD;
+         rfActive = true;
+         rfState = RF_STATE_LISTEN_ACTIVE;
+
+         LOG_TRACE(log, "RF interface activated, max payload {} initial credits {}", {maxPayload, initial});
+      }
+      else if (mt == NCI_MT_EVENT_RF && op == NCI_OP_RF_DEACTIVATE_NTF)
+      {
+         const int type = len > 0 ? packet[3] : DEACTIVATE_IDLE;
+
+         // queued data is discarded by NFCC, and credits are granted again on next activation
+         txCredits[NCI_CONN_STATIC_RF] = 0;
+         rfActive = false;
+
+         // NFCC may stay in listen sleep or go back to discovery by itself, no reconfiguration is needed in such case
+         if (type == DEACTIVATE_SLEEP || type == DEACTIVATE_SLEEP_AF)
+            rfState = RF_STATE_LISTEN_SLEEP;
+         else if (type == DEACTIVATE_DISCOVERY)
+            rfState = RF_STATE_DISCOVERY;
+         else
+            rfState = RF_STATE_IDLE;
+
+         LOG_TRACE(log, "RF interface deactivated, type {} reason {}", {type, len > 1 ? packet[4] : -1});
+      }
+      else if (mt == NCI_MT_EVENT_CORE && op == NCI_OP_CORE_RESET_NTF)
+      {
+         // all logical connections are closed by reset
+         std::fill_n(txCredits, NCI_MAX_CONNECTIONS, 0);
+         rfActive = false;
+         rfState = RF_STATE_IDLE;
+      }
+      else
+      {
+         return;
+      }
+
+      txSignal.notify_all();
+   }
+
+   /*
+    * route received packet to its ring by message type, returns message type
+    */
+   int ioRoute(const rt::ByteBuffer &packet)
+   {
+      const int mt = packet[0] & NCI_MT_MASK;
+
+      // flow control is tracked here, notifications may be consumed by caller much later
+      if (mt == NCI_MT_NOTIFICATION)
+         ioNotify(packet);
+
+      PacketRing *ring = nullptr;
+
+      switch (mt)
+      {
+         case NCI_MT_DATA:
+            ring = &rxData;
+            break;
+
+         case NCI_MT_RESPONSE:
+            ring = &rxControl;
+            break;
+
+         case NCI_MT_NOTIFICATION:
+            ring = &rxNotify;
+            break;
+
+         default:
+            log->warn("unexpected NCI message type 0x{02x}, packet discarded", {mt});
+            return mt;
+      }
+
+      std::unique_lock lock(rxMutex);
+
+      // response of command queued without waiting for it, no one takes it
+      if (ring == &rxControl && rxControlSkip > 0)
+      {
+         rxControlSkip--;
+         return mt;
+      }
+
+      // packets are never dropped, NFCC is not read again until caller takes one, so it keeps next packets with IRQ raised
+      while (ring->full() && ioRunning)
+      {
+         LOG_DEBUG(log, "NCI ring full for message type 0x{02x}, waiting for caller", {mt});
+
+         if (rxSignal.wait_for(lock, std::chrono::milliseconds(PN7160_IO_SLICE), [ring, this] { return !ring->full() || !ioRunning; }))
+            break;
+
+         // queued commands and data are still sent meanwhile, caller may be waiting for them to make room
+         lock.unlock();
+         ioFlush();
+         lock.lock();
+      }
+
+      // only on shutdown
+      if (ring->full())
+         return mt;
+
+      PacketRing::Slot &slot = ring->push();
+
+      slot.packet.put(packet).flip();
+      slot.sequence = rxSequence++;
+      slot.time = rxTime;
+
+      rxSignal.notify_all();
+
+      // events are waited by caller together with other sources
+      if (rxWaitable && ring != &rxControl)
+         rxWaitable->notify();
+
+      return mt;
+   }
+
+   /*
+    * NCI generic send command
+    */
+   bool nciSend(const rt::ByteBuffer &cmd, const bool data = false) const
+   {
+      const unsigned char target = protocol == I2C ? static_cast<char>(i2cAddress << 1) : 0x00;
+
+      LOG_TRACE(log, "TX: {x}", {cmd});
+
+      // TX buffer is copied into batch commands on submit, so it can be reused without waiting for previous packets
+      // prepare TX buffer, first byte I2C address or direction byte for SPI
+      prepare(txBuffer, 1 + cmd.remaining()).put(target).put(cmd).flip();
+
+      // set START condition, send data and set STOP condition in a single bus transaction, without waiting for completion
+      // completion runs as soon as last byte is out, data packets are timestamped there
+      if (!mpsse.submit([this](MPSSE::Queue *ops) { ops->start()->write(txBuffer)->stop(); }, [this, data](bool success) { nciSent(success, data); }))
+      {
+         log->error("nciSend submit failed: {}", {mpsse.errorString()});
+         return false;
+      }
+
+      return true;
+   }
+
+   /*
+    * NCI packet transfer completed, called from bus completion, also when batch can't be submitted so dropped data
+    * packets are accounted as well
+    */
+   void nciSent(const bool success, const bool data) const
+   {
+      if (!success)
+         log->error("nciSend data failed");
+
+      if (data)
+         ioSent();
+   }
+
+   /*
+    * get buffer with room for exactly size bytes, reallocated only when capacity is not enough
+    */
+   static rt::ByteBuffer &prepare(rt::ByteBuffer &buffer, const unsigned int size)
+   {
+      if (buffer.capacity() < size)
+         buffer = rt::ByteBuffer(std::max(size, 256u));
+
+      buffer.clear();
+      buffer.trim(buffer.capacity() - size);
+
+      return buffer;
+   }
+
    /*
     * NCI generic recv command
     */
    bool nciRecv(rt::ByteBuffer &res, const int timeout) const
    {
-      // for I2C mode send address, or 0xFF in SPI
-      const unsigned char request = static_cast<char>(protocol == I2C ? (i2cAddress << 1) | 1 : 0xff);
-
       // check if response buffer has enough capacity
       if (res.capacity() < 3)
       {
@@ -1176,82 +2556,75 @@ struct PN7160::Impl
          return false;
       }
 
-      // take start time
-      const auto startTime = std::chrono::steady_clock::now();
+      // payload bytes read speculatively with header, extra bytes are discarded
+      const unsigned int window = std::min(readWindow, res.capacity() - 3);
 
-      do
+      rt::ByteBuffer &hdr = prepare(rxHeader, 3 + window);
+
+      // wait for IRQ in hardware, set START condition, send data request (I2C address or 0xFF in SPI) and read NCI header in a single bus transaction
+      if (!mpsse.queue([&](MPSSE::Queue *ops) { ops->wait(PN7160_FT232H_IRQ_PIN, MPSSE::WAIT_HIGH, timeout)->start()->write(rxRequest)->read(hdr, timeout); }))
       {
-         if (hasMessage())
+         // IRQ not raised, batch remains armed for the next call
+         if (mpsse.isPending())
          {
-            // set START condition
-            if (!mpsse.start())
-            {
-               log->error("nciRecv start failed: {}", {mpsse.errorString()});
-               return false;
-            }
+            LOG_TRACE(log, "RX: timeout!");
+            return false;
+         }
 
-            {
-               rt::ByteBuffer hdr(3);
+         log->error("nciRecv header failed: {}", {mpsse.errorString()});
+         mpsse.stop();
+         return false;
+      }
 
-               // set STOP condition
-               rt::Finally stop([&] { mpsse.stop(); });
+      // IRQ seen and header read in same bus transaction
+      rxTime = steadyTime();
 
-               // send data request
-               if (!mpsse.write({request}))
-               {
-                  log->error("nciRecv target failed: {}", {mpsse.errorString()});
-                  return false;
-               }
+      // get response length
+      const unsigned int length = hdr[2];
 
-               // read NCI header
-               if (!mpsse.read(hdr))
-               {
-                  log->error("nciRecv read failed: {}", {mpsse.errorString()});
-                  return false;
-               }
-
-               // get response length
-               unsigned int length = hdr[2];
+      // check if response buffer has enough capacity
+      if (res.capacity() < length + 3)
+      {
+         log->error("nciRecv failed: buffer capacity {} is less than required {}", {res.capacity(), length + 3});
+         mpsse.stop();
+         return false;
+      }
 
-               // check if response buffer has enough capacity
-               if (res.capacity() < length)
-               {
-                  log->error("nciRecv failed: buffer capacity {} is less than required {}", {res.capacity(), length});
-                  return false;
-               }
+      // whole packet is already received, only STOP condition is required unless transaction was closed when wait was aborted
+      if (length <= window)
+      {
+         if (mpsse.isStarted() && !mpsse.stop())
+         {
+            log->error("nciRecv stop failed: {}", {mpsse.errorString()});
+            return false;
+         }
 
-               // data buffer to read
-               rt::ByteBuffer data(length);
+         res.put(hdr.ptr(), length + 3).flip();
 
-               // read data from bus
-               if (!mpsse.read(data))
-               {
-                  log->error("nciRecv read failed: {}", {mpsse.errorString()});
-                  return false;
-               }
+         LOG_TRACE(log, "RX: {x}", {res});
 
-               // add data and commit output buffer
-               res.put(hdr).put(data).flip();
-            }
+         return true;
+      }
 
-            LOG_TRACE(log, "RX: {x}", {res});
+      // remaining payload not covered by read window
+      rt::ByteBuffer &data = prepare(rxPayload, length - window);
 
-            return true;
-         }
+      // read payload and set STOP condition in a single bus transaction, header kept by an aborted wait had its
+      // transaction closed, then payload is read in a new one as NFCC allows split header / payload reads
+      if (!mpsse.queue([&](MPSSE::Queue *ops) { (mpsse.isStarted() ? ops : ops->start()->write(rxRequest))->read(data, PN7160_DEFAULT_TIMEOUT)->stop(); }))
+      {
+         log->error("nciRecv read failed: {}", {mpsse.errorString()});
+         return false;
       }
-      while (timeout < 0 || (std::chrono::steady_clock::now() - startTime) < std::chrono::milliseconds(timeout));
 
-      LOG_TRACE(log, "RX: timeout!");
+      // add data and commit output buffer
+      res.put(hdr);
+      res.put(data);
+      res.flip();
 
-      return false;
-   }
+      LOG_TRACE(log, "RX: {x}", {res});
 
-   /*
-    * IRQ line poll to check if PN7160 has message
-    */
-   bool hasMessage() const
-   {
-      return mpsse.getGpio(PN7160_FT232H_IRQ_PIN);
+      return true;
    }
 };
 
@@ -1279,6 +2652,17 @@ void PN7160::close()
    return impl->close();
 }
 
+void PN7160::setReadWindow(const unsigned int size)
+{
+   if (impl->protocol != SPI)
+   {
+      impl->log->warn("read window is only supported in SPI mode");
+      return;
+   }
+
+   impl->readWindow = size;
+}
+
 bool PN7160::coreReset(bool resetConfig) const
 {
    return impl->coreReset(resetConfig);
@@ -1300,14 +2684,60 @@ bool PN7160::stopDiscovery() const
    return impl->nciRfDiscoveryStop();
 }
 
+bool PN7160::updateDiscovery(const std::vector<Parameter> &parameters) const
+{
+   return impl->updateDiscoveryMode(parameters);
+}
+
+bool PN7160::resumeDiscovery() const
+{
+   return impl->resumeDiscoveryMode();
+}
+
+PN7160::RfState PN7160::rfState() const
+{
+   return static_cast<RfState>(impl->rfState.load());
+}
+
+PN7160::Deactivation PN7160::lastDeactivation() const
+{
+   return impl->rfDeactivation;
+}
+
+const PN7160::Activation &PN7160::lastActivation() const
+{
+   return impl->rfActivation;
+}
+
 int PN7160::waitEvent(rt::ByteBuffer &data, const int timeout) const
 {
    return impl->waitEvent(data, timeout);
 }
 
-bool PN7160::sendData(const rt::ByteBuffer &data) const
+unsigned long long PN7160::eventTime() const
+{
+   return impl->rxEventTime;
+}
+
+unsigned long long PN7160::sendTime(const int timeout) const
+{
+   return impl->sendTime(timeout);
+}
+
+void PN7160::attach(const std::shared_ptr<rt::Waitable> &waitable) const
+{
+   std::lock_guard lock(impl->rxMutex);
+
+   impl->rxWaitable = waitable;
+
+   // pending events must be seen by waiter
+   if (waitable && (!impl->rxNotify.empty() || !impl->rxData.empty()))
+      waitable->notify();
+}
+
+bool PN7160::sendData(const rt::ByteBuffer &data, const int timeout) const
 {
-   return impl->sendData(data);
+   return impl->sendData(data, timeout);
 }
 
 bool PN7160::recvData(rt::ByteBuffer &data, const int timeout) const
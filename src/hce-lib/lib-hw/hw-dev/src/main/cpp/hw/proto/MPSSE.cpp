@@ -21,8 +21,18 @@
 
 #include <unistd.h>
 
-#include "rt/Finally.h"
-
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+
+#include <libusb.h>
 #include <libftdi1/ftdi.h>
 
 #include <rt/Logger.h>
@@ -42,8 +52,15 @@
 #define TIMEOUT_DIVISOR             1000000
 #define USB_TIMEOUT                 500
 #define SETUP_DELAY                 25000
+#define QUEUE_BUFFER_SIZE           512
+#define DIRECT_BUFFER_SIZE          32
+#define START_STOP_SIZE             9
+#define WAIT_SIZE                   2
+
+#define USB_STATUS_SIZE             2
 
 #define CMD_SET_BITS_ADBUS          0x80
+#define CMD_GET_BITS_ADBUS          0x81
 #define CMD_SET_BITS_ACBUS          0x82
 #define CMD_SEND_IMMEDIATE          0x87
 #define CMD_WAIT_ON_HIGH            0x88
@@ -81,24 +98,29 @@ struct ftdi_profile
 {
    int vid;
    int pid;
+   int channels; // number of MPSSE capable channels
+   bool acbus; // channels have high byte GPIO
    const char *description;
 };
 
 ftdi_profile ftdi_profiles[] = {
-   {0x0403, 0x6010, "FT2232 Future Technology Devices International, Ltd"},
-   {0x0403, 0x6011, "FT4232 Future Technology Devices International, Ltd"},
-   {0x0403, 0x6014, "FT232H Future Technology Devices International, Ltd"},
+   {0x0403, 0x6010, 2, true, "FT2232 Future Technology Devices International, Ltd"},
+   {0x0403, 0x6011, 2, false, "FT4232 Future Technology Devices International, Ltd"},
+   {0x0403, 0x6014, 1, true, "FT232H Future Technology Devices International, Ltd"},
 
    /* These devices are based on FT2232 chips, but have not been tested. */
-   {0x0403, 0x8878, "Bus Blaster v2 (channel A)"},
-   {0x0403, 0x8879, "Bus Blaster v2 (channel B)"},
-   {0x0403, 0xBDC8, "Turtelizer JTAG/RS232 Adapter A"},
-   {0x0403, 0xCFF8, "Amontec JTAGkey"},
-   {0x0403, 0x8A98, "TIAO Multi Protocol Adapter"},
-   {0x15BA, 0x0003, "Olimex Ltd. OpenOCD JTAG"},
-   {0x15BA, 0x0004, "Olimex Ltd. OpenOCD JTAG TINY"},
+   {0x0403, 0x8878, 2, true, "Bus Blaster v2 (channel A)"},
+   {0x0403, 0x8879, 2, true, "Bus Blaster v2 (channel B)"},
+   {0x0403, 0xBDC8, 2, true, "Turtelizer JTAG/RS232 Adapter A"},
+   {0x0403, 0xCFF8, 2, true, "Amontec JTAGkey"},
+   {0x0403, 0x8A98, 2, true, "TIAO Multi Protocol Adapter"},
+   {0x15BA, 0x0003, 2, true, "Olimex Ltd. OpenOCD JTAG"},
+   {0x15BA, 0x0004, 2, true, "Olimex Ltd. OpenOCD JTAG TINY"},
 };
 
+// profile of channels opened over an external link
+ftdi_profile link_profile = {0, 0, 1, true, "MPSSE link"};
+
 struct mpsse_mode
 {
    uint8_t pstart;
@@ -150,6 +172,56 @@ enum mpsse_status
    Started = 1
 };
 
+struct MPSSE::Queue::Impl
+{
+   struct Segment
+   {
+      rt::ByteBuffer *data; // target buffer, or null to discard
+      unsigned int length; // number of bytes
+      bool ack; // I2C ACK bits to be verified
+   };
+
+   // device context
+   MPSSE::Impl *device;
+
+   // encoded commands
+   rt::ByteBuffer cmd;
+
+   // response data, reused between batches
+   rt::ByteBuffer rsp;
+
+   // response segments, in same order as requested
+   std::vector<Segment> segments;
+
+   // total response length
+   unsigned int length = 0;
+
+   // response timeout, negative for no limit, write only batches wait as long as a USB transfer
+   int timeout = USB_TIMEOUT;
+
+   // timeout set by read or wait requests
+   bool timed = false;
+
+   // bus status before encoding
+   int status;
+
+   // batch contains wait operations
+   bool wait = false;
+
+   // batch encoding is valid
+   bool valid = true;
+
+   explicit Impl(MPSSE::Impl *device);
+
+   void reset();
+
+   void reserve(unsigned int size);
+
+   void expect(int limit);
+
+   rt::ByteBuffer &response();
+};
+
 struct MPSSE::Impl
 {
    rt::Logger *log = rt::Logger::getLogger("hw.MPSSE");
@@ -157,20 +229,99 @@ struct MPSSE::Impl
    Protocol protocol;
 
    unsigned int clock;
-   unsigned int interface;
+   Channel channel = CHANNEL_A;
    std::string description;
    std::string serial;
 
    int status = Stopped;
    int txsize = 0;
 
+   // position of first NACK in last batch written bytes, -1 if none
+   int nack = -1;
+
+   // batch with wait operation still armed in the device after timeout
+   bool pending = false;
+   rt::ByteBuffer pendingCmd;
+   rt::ByteBuffer pendingRsp;
+
+   // armed batch completed while being cancelled, its response is kept until same batch is resumed
+   bool pendingDone = false;
+   rt::ByteBuffer pendingData;
+
+   // number of buffers allocated by MPSSE, transport libraries allocate their own transfer state per USB transfer
+   std::atomic<unsigned long> allocations {0};
+
+   // command arena for synchronous batches
+   std::shared_ptr<Queue::Impl> arena;
+
+   // command buffer for direct pin and clock commands
+   rt::ByteBuffer direct;
+
+   // precomputed pin sequences for current mode
+   struct Sequence
+   {
+      unsigned char data[START_STOP_SIZE];
+      unsigned int length;
+
+      void assign(rt::ByteBuffer &buffer)
+      {
+         buffer.flip();
+         length = buffer.remaining();
+         buffer.get(data, length);
+      }
+   };
+
+   Sequence seqStart {};
+   Sequence seqRestart {};
+   Sequence seqStop {};
+
+   // asynchronous batch in flight
+   struct Transfer
+   {
+      std::shared_ptr<Queue::Impl> ops;
+      ftdi_transfer_control *write = nullptr;
+      Usb::Transfer usbWrite;
+      bool written = false;
+      Completion completion;
+   };
+
+   // asynchronous transfers, in submission order, completed by worker thread
+   std::list<Transfer> transfers;
+
+   // completed transfers, reused for next submissions
+   std::list<Transfer> transferPool;
+
+   std::mutex transferMutex;
+   std::condition_variable transferSignal;
+   std::thread transferWorker;
+   bool transferRunning = false;
+
+   // number of transfers in flight with response data
+   unsigned int transferReads = 0;
+
    mpsse_mode mode {};
 
    ftdi_profile *profile = nullptr;
 
    ftdi_context *ftdi = nullptr;
 
-   Impl()
+   // libftdi context is not thread safe, all calls on it from caller and worker threads are serialized here
+   mutable std::mutex ftdiMutex;
+
+   // bulk data path, libftdi is only used for device setup when direct USB transport is selected
+   Transport transport = TRANSPORT_FTDI;
+   Usb usb;
+   unsigned int packetSize = 512;
+
+   // bulk endpoints and control request index of selected channel
+   int usbEndpointIn = 1;
+   int usbEndpointOut = 2;
+   int usbIndex = 1;
+
+   // external byte stream, replaces libftdi and USB transfers when transport is TRANSPORT_LINK
+   std::shared_ptr<Link> link;
+
+   Impl() : direct(allocate(DIRECT_BUFFER_SIZE))
    {
       // ftdilib initialization
       if (ftdi = ftdi_new(); ftdi == nullptr)
@@ -185,40 +336,67 @@ struct MPSSE::Impl
          ftdi_free(ftdi);
    }
 
-   int open(const Protocol protocol, const unsigned int clock, const ByteOrder endianess)
+   /*
+    * enumerate attached devices with known profile, in bus order
+    */
+   static std::vector<std::pair<Usb::Descriptor, ftdi_profile *>> scan()
    {
-      close();
-
-      Usb::Descriptor descriptor {};
+      std::vector<std::pair<Usb::Descriptor, ftdi_profile *>> devices;
 
       for (const auto &dev: Usb::list())
       {
-         // search for Sipeed device profile
          for (auto &p: ftdi_profiles)
          {
-            if (!(dev.vid == p.vid && dev.pid == p.pid))
-               continue;
+            if (dev.vid == p.vid && dev.pid == p.pid)
+            {
+               devices.emplace_back(dev, &p);
+               break;
+            }
+         }
+      }
+
+      return devices;
+   }
 
-            // profile detected
-            profile = &p;
+   int open(const Protocol protocol, const unsigned int clock, const ByteOrder endianess, const Transport mode, const std::string &device, const Channel port)
+   {
+      close();
 
-            // descriptor
-            descriptor = dev;
+      Usb::Descriptor descriptor {};
 
-            break;
-         }
+      // device selected by enumeration index or serial number
+      const int index = !device.empty() && device[0] == '#' ? std::atoi(device.c_str() + 1) : -1;
 
-         if (profile)
-            break;
+      const auto devices = scan();
+
+      for (int i = 0; i < static_cast<int>(devices.size()); i++)
+      {
+         if (!device.empty() && (index >= 0 ? i != index : devices[i].first.serial != device))
+            continue;
+
+         descriptor = devices[i].first;
+         profile = devices[i].second;
+
+         break;
       }
 
       if (!profile)
       {
-         log->warn("no FTDI device found!");
+         log->warn("no FTDI device found{}", {device.empty() ? std::string() : " for selector " + device});
+         return false;
+      }
+
+      if (port >= profile->channels)
+      {
+         log->warn("device {} has no MPSSE channel {}", {profile->description, std::string(1, static_cast<char>('A' + port))});
+         profile = nullptr;
          return false;
       }
 
-      LOG_INFO(log, "open device {} {} on bus {03} device {03}", { descriptor.manufacturer, descriptor.product, descriptor.bus, descriptor.address});
+      // each channel is a separate USB interface with its own pin states, kept in this instance
+      channel = port;
+
+      LOG_INFO(log, "open device {} {} serial {} on bus {03} port {03} device {03}", {descriptor.manufacturer, descriptor.product, descriptor.serial, descriptor.bus, descriptor.port, descriptor.address});
 
       int res = 0;
 
@@ -229,11 +407,11 @@ struct MPSSE::Impl
          ftdi->usb_write_timeout = USB_TIMEOUT;
 
          /* Set the FTDI interface  */
-         if (res = ftdi_set_interface(ftdi, INTERFACE_A); res != 0)
+         if (res = ftdi_set_interface(ftdi, channel == CHANNEL_B ? INTERFACE_B : INTERFACE_A); res != 0)
             break;
 
-         /* Open the specified device */
-         if (res = ftdi_usb_open_desc_index(ftdi, descriptor.vid, descriptor.pid, nullptr, nullptr, 0); res != 0)
+         /* Open the specified device, bus address identifies it even when several devices share VID / PID */
+         if (res = ftdi_usb_open_bus_addr(ftdi, descriptor.bus, descriptor.address); res != 0)
             break;
 
          if (res = ftdi_usb_reset(ftdi); res != 0)
@@ -266,7 +444,12 @@ struct MPSSE::Impl
           */
          ftdi_tciflush(ftdi);
 
+         // switch bulk data path to direct USB transfers
+         if (mode == TRANSPORT_USB && !usbOpen(descriptor))
+            break;
+
          // set port properties
+         this->serial = descriptor.serial;
          this->status = Stopped;
          this->txsize = protocol == I2C ? I2C_TRANSFER_SIZE : SPI_RW_SIZE;
 
@@ -284,280 +467,888 @@ struct MPSSE::Impl
       return false;
    }
 
+   /*
+    * open channel over external link, same engine setup as for attached devices
+    */
+   bool open(const std::shared_ptr<Link> &stream, const Protocol protocol, const unsigned int clock, const ByteOrder endianess)
+   {
+      close();
+
+      if (!stream)
+      {
+         log->warn("no link to open");
+         return false;
+      }
+
+      link = stream;
+      profile = &link_profile;
+      channel = CHANNEL_A;
+      transport = TRANSPORT_LINK;
+
+      if (ftdiBitmode(BITMODE_MPSSE) && setClock(clock) && setMode(protocol, endianess))
+      {
+         // discard errors from unsupported set up commands
+         ftdiPurge();
+
+         this->serial.clear();
+         this->status = Stopped;
+         this->txsize = protocol == I2C ? I2C_TRANSFER_SIZE : SPI_RW_SIZE;
+
+         LOG_INFO(log, "device {} ready!", {profile->description});
+
+         return true;
+      }
+
+      log->warn("failed to open link: {}", {ftdiError()});
+
+      close();
+
+      return false;
+   }
+
    void close()
    {
-      if (profile)
+      // complete all asynchronous transfers and finish worker
+      if (transferWorker.joinable())
+      {
+         {
+            std::lock_guard lock(transferMutex);
+            transferRunning = false;
+         }
+
+         transferSignal.notify_all();
+         transferWorker.join();
+      }
+
+      if (transport == TRANSPORT_USB)
+      {
+         usb.releaseInterface(channel);
+         usb.close();
+      }
+
+      if (profile && transport != TRANSPORT_LINK)
          ftdi_deinit(ftdi);
 
+      link.reset();
       profile = nullptr;
+      pending = false;
+      pendingDone = false;
+      transport = TRANSPORT_FTDI;
    }
 
-   int start()
+   /*
+    * release device from libftdi and claim it for direct bulk transfers, MPSSE mode and latency persist in the chip
+    */
+   bool usbOpen(const Usb::Descriptor &descriptor)
    {
-      if (!profile)
+      // interface can be claimed only by one handle
+      ftdi_usb_close(ftdi);
+
+      usb = Usb(descriptor);
+
+      if (!usb.open() || !usb.isOpen())
+      {
+         log->error("failed to open USB device");
+         return false;
+      }
+
+      if (!usb.claimInterface(channel))
+      {
+         usb.close();
          return false;
+      }
+
+      packetSize = usb.isHighSpeed() ? 512 : 64;
+      transport = TRANSPORT_USB;
+
+      // channel A uses endpoints 0x81 / 0x02, channel B 0x83 / 0x04
+      usbEndpointIn = 1 + channel * 2;
+      usbEndpointOut = 2 + channel * 2;
+      usbIndex = 1 + channel;
+
+      LOG_INFO(log, "direct USB transport enabled, packet size {}", {packetSize});
 
-      if (protocol == I2C && status == Started)
+      return true;
+   }
+
+   bool start()
+   {
+      return queue([](Queue *ops) { ops->start(); });
+   }
+
+   bool stop()
+   {
+      return queue([](Queue *ops) { ops->stop(); });
+   }
+
+   bool read(rt::ByteBuffer &data, const int timeout)
+   {
+      LOG_INFO(log, "read {} bytes", {data.remaining()});
+
+      if (!queue([&](Queue *ops) { ops->read(data, timeout); }))
       {
-         /* Set the default pin states while the clock is low since this is an I2C repeated start condition */
-         if (!ftdiGpioLow(mode.pidle & ~SK))
-            return false;
+         log->error("failed to read data in {} mode", {protocol == I2C ? "I2C" : "SPI"});
+         return false;
+      }
 
-         /* Make sure the pins are in their default idle state */
-         if (!ftdiGpioLow(mode.pidle))
-            return false;
+      LOG_DEBUG(log, "MPSSE RX: {x}", {data.copy()});
+
+      return true;
+   }
+
+   bool write(const rt::ByteBuffer &data)
+   {
+      LOG_INFO(log, "write {} bytes", {data.remaining()});
+
+      LOG_DEBUG(log, "MPSSE TX: {x}", {data.copy()});
+
+      if (!queue([&](Queue *ops) { ops->write(data); }))
+      {
+         log->error("failed to write data in {} mode", {protocol == I2C ? "I2C" : "SPI"});
+         return false;
       }
 
-      /* Set the start condition */
-      if (!ftdiGpioLow(mode.pstart))
+      return true;
+   }
+
+   /*
+    * encode all batch operations in one command buffer and execute it in a single USB round trip
+    */
+   bool queue(const Batch &batch)
+   {
+      if (!profile)
          return false;
 
-      /*
-       * Hackish work around to properly support SPI mode 3.
-       * SPI3 clock idles high, but needs to be set low before sending out
-       * data to prevent unintenteded clock glitches from the FT2232.
-       */
-      if (protocol == SPI3)
+      // command arena is reused between synchronous batches
+      if (!arena)
+      {
+         allocations++;
+         arena = std::make_shared<Queue::Impl>(this);
+      }
+
+      arena->reset();
+
+      Queue ops(arena);
+
+      // encode all operations
+      batch(&ops);
+
+      // and execute them
+      return execute(*arena);
+   }
+
+   /*
+    * allocate new buffer, all MPSSE allocations goes here to keep track of them
+    */
+   rt::ByteBuffer allocate(const unsigned int size)
+   {
+      allocations++;
+
+      return rt::ByteBuffer(size);
+   }
+
+   bool execute(Queue::Impl &ops)
+   {
+      nack = -1;
+
+      if (!ops.valid)
+      {
+         log->error("invalid batch, operations not executed");
+         status = ops.status;
+         return false;
+      }
+
+      // nothing to do...
+      if (ops.cmd.position() == 0)
+         return true;
+
+      // responses of asynchronous transfers must be received before
+      drain(false);
+
+      // force device to flush response data as soon as the last command is processed
+      if (ops.length > 0)
+         ops.cmd.put(CMD_SEND_IMMEDIATE);
+
+      ops.cmd.flip();
+
+      rt::ByteBuffer rsp;
+
+      // other wait batch replaces completed one, its response is not taken by anyone
+      if (pendingDone && ops.wait && ops.cmd != pendingCmd)
+      {
+         log->warn("completed wait batch not resumed, {} response bytes discarded", {pendingData.remaining()});
+         pending = pendingDone = false;
+      }
+
+      // armed batch completed while it was cancelled, its bus transaction was closed then
+      if (pendingDone && ops.cmd == pendingCmd)
+      {
+         pending = pendingDone = false;
+         status = Stopped;
+
+         return (nack = scatter(ops, pendingData)) < 0;
+      }
+
+      // same wait batch is still armed in the device, resume it
+      if (pending && ops.wait && ops.cmd == pendingCmd)
+      {
+         rsp = pendingRsp;
+      }
+      else
       {
-         if (!ftdiGpioLow(mode.pstart & ~SK))
+         // any other operation requires aborting the armed wait
+         if (pending && !cancel())
+         {
+            log->error("failed to cancel pending wait");
+            return false;
+         }
+
+         // send all commands in one transfer
+         if (!ftdiSend(ops.cmd))
+         {
+            log->error("failed to send batch of {} bytes", {ops.cmd.remaining()});
             return false;
+         }
+
+         // no data expected
+         if (ops.length == 0)
+            return true;
+
+         rsp = ops.response();
       }
 
-      /*
-       * Hackish work around to properly support SPI mode 1.
-       * SPI1 clock idles low, but needs to be set high before sending out
-       * data to preven unintended clock glitches from the FT2232.
-       */
-      if (protocol == SPI1)
+      pending = false;
+
+      // and read all response data in one transfer
+      if (!ftdiRecv(rsp, ops.timeout))
       {
-         if (!ftdiGpioLow(mode.pstart | SK))
+         // wait condition not reached, keep batch armed until next call
+         if (ops.wait)
+         {
+            // keep a copy of armed commands, arena is overwritten by next batch
+            if (pendingCmd.capacity() < ops.cmd.remaining())
+               pendingCmd = allocate(ops.cmd.capacity());
+
+            pendingCmd.clear();
+            pendingCmd.put(ops.cmd.ptr(), ops.cmd.remaining());
+            pendingCmd.flip();
+
+            pending = true;
+            pendingRsp = rsp;
+            status = ops.status;
+
             return false;
+         }
+
+         log->error("failed to receive batch response of {} bytes", {ops.length});
+         return false;
       }
 
-      status = Started;
+      // scatter response data into caller buffers
+      if (nack = scatter(ops, rsp); nack >= 0)
+         return false;
 
       return true;
    }
 
-   int stop()
+   /*
+    * copy response data into caller buffers and verify deferred ACKs, returns position of first NACK or -1
+    */
+   int scatter(const Queue::Impl &ops, rt::ByteBuffer &rsp) const
+   {
+      // number of written bytes in whole batch, first NACK position is reported against it
+      unsigned int written = 0;
+
+      int position = -1;
+
+      for (const auto &[data, length, ack]: ops.segments)
+      {
+         if (data)
+            data->put(rsp.ptr(), length).flip();
+
+         if (ack)
+         {
+            for (unsigned int i = 0; i < length && position < 0; i++)
+            {
+               // ACK bit is sampled in LSB, high level means NACK
+               if (rsp[rsp.position() + i] & 0x01)
+                  position = static_cast<int>(written + i);
+            }
+
+            written += length;
+         }
+
+         rsp.skip(length);
+      }
+
+      if (position >= 0)
+         log->error("NACK received at byte {} of {}", {position, written});
+
+      return position;
+   }
+
+   /*
+    * execute batch asynchronously, commands are submitted now and response is received by worker thread
+    */
+   bool submit(const Batch &batch, const Completion &completion)
    {
       if (!profile)
+      {
+         completion(false);
          return false;
+      }
 
-      /* In I2C mode, we need to ensure that the data line goes low while the clock line is low to avoid sending an inadvertent start condition */
-      if (protocol == I2C)
+      std::unique_lock lock(transferMutex);
+
+      // transfers and their command arenas are reused once completed
+      if (transferPool.empty())
       {
-         /* Set the default pin states while the clock is low since this is an I2C repeated start condition */
-         if (!ftdiGpioLow(mode.pidle & ~DO & ~SK))
-            return false;
+         allocations++;
+
+         Transfer &created = transferPool.emplace_back();
+
+         created.ops = std::make_shared<Queue::Impl>(this);
+         created.usbWrite.user = &created;
+         created.usbWrite.callback = [this](Usb::Transfer *write) -> Usb::Transfer * {
+            std::lock_guard lock(transferMutex);
+            static_cast<Transfer *>(write->user)->written = true;
+            transferSignal.notify_all();
+            return nullptr;
+         };
       }
 
-      /* Send the stop condition */
-      if (!ftdiGpioLow(mode.pstop))
+      Transfer &transfer = transferPool.front();
+
+      transfer.ops->reset();
+      transfer.completion = completion;
+
+      lock.unlock();
+
+      Queue ops(transfer.ops);
+
+      // encode all operations
+      batch(&ops);
+
+      // wait operations may block device indefinitely, only supported in synchronous batches
+      if (!transfer.ops->valid || transfer.ops->wait)
+      {
+         log->error("invalid asynchronous batch, operations not executed");
+         status = transfer.ops->status;
+         completion(false);
          return false;
+      }
 
-      /* Restore the pins to their idle states */
-      if (!ftdiGpioLow(mode.pidle))
+      // nothing to do...
+      if (transfer.ops->cmd.position() == 0)
+      {
+         completion(true);
+         return true;
+      }
+
+      // any other operation requires aborting the armed wait
+      if (pending && !cancel())
+      {
+         log->error("failed to cancel pending wait");
+         completion(false);
          return false;
+      }
 
-      status = Stopped;
+      // force device to flush response data as soon as the last command is processed
+      if (transfer.ops->length > 0)
+      {
+         transfer.ops->cmd.put(CMD_SEND_IMMEDIATE);
+         transfer.ops->response();
+      }
 
-      return true;
+      transfer.ops->cmd.flip();
+
+      lock.lock();
 
+      // worker is started on first asynchronous batch
+      if (!transferRunning)
+      {
+         if (transferWorker.joinable())
+            transferWorker.join();
+
+         transferRunning = true;
+         transferWorker = std::thread([this] { transferLoop(); });
+      }
+
+      // commands are submitted in order, responses are requested by worker
+      if (!transferSubmit(transfer))
+      {
+         log->error("failed to submit batch of {} bytes", {transfer.ops->cmd.remaining()});
+         lock.unlock();
+         completion(false);
+         return false;
+      }
+
+      LOG_DEBUG(log, "FTDI TX: {x}", {transfer.ops->cmd.copy()});
+
+      if (transfer.ops->length > 0)
+         transferReads++;
+
+      transfers.splice(transfers.end(), transferPool, transferPool.begin());
+
+      transferSignal.notify_all();
+
+      return true;
    }
 
-   bool read(rt::ByteBuffer &data, const int timeout)
+   /*
+    * submit batch commands without waiting for completion
+    */
+   bool transferSubmit(Transfer &transfer)
    {
-      if (!profile)
-         return false;
+      if (transport == TRANSPORT_USB)
+      {
+         transfer.written = false;
+         transfer.usbWrite.status = Usb::Issued;
+         transfer.usbWrite.data = transfer.ops->cmd.ptr();
+         transfer.usbWrite.available = transfer.ops->cmd.remaining();
+         transfer.usbWrite.timeout = USB_TIMEOUT;
 
-      LOG_INFO(log, "read {} bytes", {data.remaining()});
+         return usb.asyncTransfer(Usb::Out, usbEndpointOut, &transfer.usbWrite);
+      }
 
-      rt::ByteBuffer cmd(16);
+      std::lock_guard lock(ftdiMutex);
 
-      // I2C mode
-      if (protocol == I2C)
+      // link accepts commands without blocking, response is received by worker
+      if (transport == TRANSPORT_LINK)
+         return link->write(transfer.ops->cmd.ptr(), transfer.ops->cmd.remaining());
+
+      transfer.write = ftdi_write_data_submit(ftdi, transfer.ops->cmd.ptr(), static_cast<int>(transfer.ops->cmd.remaining()));
+
+      return transfer.write != nullptr;
+   }
+
+   /*
+    * complete asynchronous transfers in submission order
+    */
+   void transferLoop()
+   {
+      std::unique_lock lock(transferMutex);
+
+      while (true)
       {
-         rt::ByteBuffer ack(1);
+         transferSignal.wait(lock, [this] { return !transfers.empty() || !transferRunning; });
 
-         // ensure that the clock pin is set low prior to clocking out data
-         cmd.put(CMD_SET_BITS_ADBUS).put(mode.pstart & ~SK).put(mode.trisl & ~DO);
+         // finish only when all transfers are completed
+         if (transfers.empty())
+            break;
 
-         // now add RX command, data length 0 = required bytes - 1
-         cmd.put(mode.rx).put(data.remaining() - 1).put(0);
+         Transfer &transfer = transfers.front();
 
-         // we need to make data out an input to avoid contention
-         cmd.put(CMD_SET_BITS_ADBUS).put(mode.pstart & ~SK).put(mode.trisl);
+         lock.unlock();
+
+         // completion is notified before transfer is released, so drain() returns with all results delivered
+         transfer.completion(transferComplete(transfer));
+
+         lock.lock();
+
+         if (transfer.ops->length > 0)
+            transferReads--;
+
+         transferPool.splice(transferPool.end(), transfers, transfers.begin());
+
+         transferSignal.notify_all();
+      }
+   }
 
-         // and read ACK after each byte
-         cmd.put(mode.rx | MPSSE_BITMODE).put(0).put(mode.tack);
+   /*
+    * wait for asynchronous commands and receive response while next commands are already in flight
+    */
+   bool transferComplete(Transfer &transfer)
+   {
+      const Queue::Impl &ops = *transfer.ops;
+
+      // response buffer is prepared on submission
+      rt::ByteBuffer rsp = ops.rsp;
+
+      // direct transport, response is received while commands are written
+      if (transport == TRANSPORT_USB)
+      {
+         bool received = ops.length == 0 || usbRecv(rsp, ops.timeout);
+
+         if (!received)
+            log->error("failed to receive batch response of {} bytes", {ops.length});
+
+         std::unique_lock lock(transferMutex);
+
+         transferSignal.wait(lock, [&transfer] { return transfer.written; });
 
-         // prepare buffer for send
-         cmd.flip();
+         lock.unlock();
 
-         // send read request!
-         if (!ftdiSend(cmd))
+         if (transfer.usbWrite.status != Usb::Completed || transfer.usbWrite.actual != ops.cmd.remaining())
          {
-            log->error("failed to send read request in I2C mode");
+            log->error("failed to send batch of {} bytes", {ops.cmd.remaining()});
             return false;
          }
 
-         // and read data back
-         if (!ftdiRecv(data, timeout))
+         return received && (ops.length == 0 || scatter(ops, rsp) < 0);
+      }
+
+      // commands already written on submission
+      if (transport == TRANSPORT_LINK)
+      {
+         if (ops.length == 0)
+            return true;
+
+         if (!ftdiRecv(rsp, ops.timeout))
          {
-            log->error("failed to read data in I2C mode");
+            log->error("failed to receive batch response of {} bytes", {ops.length});
             return false;
          }
+
+         return scatter(ops, rsp) < 0;
       }
 
-      // SPI mode
-      else
+      ftdi_transfer_control *read = nullptr;
+
+      // request response as soon as possible, only one read may be in flight
+      if (ops.length > 0)
       {
-         while (data.remaining() > 0)
-         {
-            rt::ByteBuffer block(data.remaining() > txsize ? txsize : data.remaining());
+         std::lock_guard lock(ftdiMutex);
 
-            // now add TX command, data length 0 = 1 byte for I2C
-            cmd.put(mode.rx);
-            cmd.putInt(block.remaining() - 1, 2);
-            cmd.flip();
+         if (read = ftdi_read_data_submit(ftdi, rsp.ptr(), static_cast<int>(ops.length)); !read)
+            log->error("failed to submit read of {} bytes", {ops.length});
+      }
 
-            // send read request!
-            if (!ftdiSend(cmd))
-            {
-               log->error("failed to send read request in I2C mode");
-               return false;
-            }
+      // stalled write must not block worker forever, it is bounded by batch timeout but never below USB timeout
+      bool success = ftdiWait(transfer.write, std::max(ops.timeout, USB_TIMEOUT)) == static_cast<int>(ops.cmd.remaining());
 
-            // and read data back
-            if (!ftdiRecv(block, timeout))
-            {
-               log->error("failed to read data in I2C mode");
-               return false;
-            }
+      if (!success)
+         log->error("failed to send batch of {} bytes", {ops.cmd.remaining()});
 
-            // add block to data buffer
-            data.put(block);
+      // no data expected
+      if (ops.length == 0)
+         return success;
 
-            // prepare for next block
-            cmd.clear();
-         }
+      if (!read)
+         return false;
+
+      if (ftdiWait(read, ops.timeout) != static_cast<int>(ops.length))
+      {
+         log->error("failed to receive batch response of {} bytes", {ops.length});
+         return false;
+      }
+
+      LOG_DEBUG(log, "FTDI RX: {x}", {rsp.copy()});
+
+      return success && scatter(ops, rsp) < 0;
+   }
+
+   /*
+    * wait until asynchronous transfers are completed, all of them or only those with response data
+    */
+   void drain(const bool all)
+   {
+      std::unique_lock lock(transferMutex);
+
+      transferSignal.wait(lock, [this, all] { return all ? transfers.empty() : transferReads == 0; });
+   }
+
+   /*
+    * abort armed wait command, the only way to do it is resetting MPSSE engine and restore clock and pin states;
+    * if wait condition was already reached response data is kept for resumed batch instead of being purged
+    */
+   bool cancel()
+   {
+      // engine is already idle, kept response waits for its batch
+      if (pendingDone)
+         return true;
+
+      LOG_DEBUG(log, "cancel pending wait");
+
+      // engine reset must not interrupt asynchronous commands
+      drain(true);
+
+      // batch may have completed since last poll, then engine is idle and no reset is needed
+      if (ftdiRecv(pendingRsp, 0))
+      {
+         // bus transaction left open by armed batch is closed before any other command
+         direct.clear();
+         encodeStop(direct);
+         direct.flip();
+
+         return keep() && ftdiSend(direct);
+      }
+
+      pending = false;
+
+      // all pins are inputs while engine is reset, so pin states are driven again before anything else
+      if (!ftdiBitmode(BITMODE_RESET) || !ftdiBitmode(BITMODE_MPSSE) || !applyMode())
+         return false;
+
+      status = Stopped;
+
+      // response completed while engine was being reset, bus transaction was ended by reset
+      if (ftdiRecv(pendingRsp, 0))
+         return setClock(clock) && keep();
+
+      if (pendingRsp.position() > 0)
+         log->error("armed batch interrupted after {} response bytes, data discarded", {pendingRsp.position()});
+
+      // discard partial responses
+      ftdiPurge();
+
+      return setClock(clock);
+   }
+
+   /*
+    * keep response of completed armed batch until it is resumed, response buffer is reused by next batches
+    */
+   bool keep()
+   {
+      LOG_DEBUG(log, "armed batch completed while cancelling, response kept");
+
+      if (pendingData.capacity() < pendingRsp.remaining())
+         pendingData = allocate(pendingRsp.capacity());
+
+      pendingData.clear();
+      pendingData.put(pendingRsp.ptr(), pendingRsp.remaining());
+      pendingData.flip();
+
+      pending = true;
+      pendingDone = true;
+
+      return true;
+   }
+
+   /*
+    * encode wait for GPIO level, followed by a pin read to get notified when level is reached
+    */
+   bool encodeWait(rt::ByteBuffer &cmd, const int gpio, const Wait level) const
+   {
+      // MPSSE wait command only works over GPIOL1 pin
+      if (gpio != GPIOL1)
+      {
+         log->error("wait is only supported on GPIOL1, requested {}", {gpio});
+         return false;
+      }
+
+      cmd.put(level == WAIT_HIGH ? CMD_WAIT_ON_HIGH : CMD_WAIT_ON_LOW);
+      cmd.put(CMD_GET_BITS_ADBUS);
+
+      return true;
+   }
+
+   /*
+    * encode START condition
+    */
+   void encodeStart(rt::ByteBuffer &cmd)
+   {
+      // I2C repeated start condition requires restoring idle pin states first
+      const Sequence &seq = protocol == I2C && status == Started ? seqRestart : seqStart;
+
+      cmd.put(seq.data, seq.length);
+
+      status = Started;
+   }
+
+   /*
+    * encode STOP condition
+    */
+   void encodeStop(rt::ByteBuffer &cmd)
+   {
+      cmd.put(seqStop.data, seqStop.length);
+
+      status = Stopped;
+   }
+
+   /*
+    * precompute START / STOP pin sequences, must be called after any change in mode pin states
+    */
+   void updateSequences()
+   {
+      rt::ByteBuffer seq(direct);
+
+      // START condition
+      seq.clear();
+
+      /* Set the start condition */
+      encodeGpioLow(seq, mode.pstart);
+
+      /*
+       * Hackish work around to properly support SPI mode 3.
+       * SPI3 clock idles high, but needs to be set low before sending out
+       * data to prevent unintenteded clock glitches from the FT2232.
+       */
+      if (protocol == SPI3)
+         encodeGpioLow(seq, mode.pstart & ~SK);
+
+      /*
+       * Hackish work around to properly support SPI mode 1.
+       * SPI1 clock idles low, but needs to be set high before sending out
+       * data to preven unintended clock glitches from the FT2232.
+       */
+      if (protocol == SPI1)
+         encodeGpioLow(seq, mode.pstart | SK);
+
+      seqStart.assign(seq);
+
+      // I2C repeated START condition
+      seq.clear();
+
+      /* Set the default pin states while the clock is low since this is an I2C repeated start condition */
+      encodeGpioLow(seq, mode.pidle & ~SK);
+
+      /* Make sure the pins are in their default idle state */
+      encodeGpioLow(seq, mode.pidle);
+
+      /* Set the start condition */
+      encodeGpioLow(seq, mode.pstart);
+
+      seqRestart.assign(seq);
+
+      // STOP condition
+      seq.clear();
+
+      /* In I2C mode, we need to ensure that the data line goes low while the clock line is low to avoid sending an inadvertent start condition */
+      if (protocol == I2C)
+         encodeGpioLow(seq, mode.pidle & ~DO & ~SK);
+
+      /* Send the stop condition */
+      encodeGpioLow(seq, mode.pstop);
+
+      /* Restore the pins to their idle states */
+      encodeGpioLow(seq, mode.pidle);
+
+      seqStop.assign(seq);
+   }
+
+   /*
+    * encode read request, returns the number of bytes that device sends back
+    */
+   unsigned int encodeRead(rt::ByteBuffer &cmd, const unsigned int length) const
+   {
+      if (length == 0)
+         return 0;
+
+      // I2C mode
+      if (protocol == I2C)
+      {
+         // ensure that the clock pin is set low prior to clocking out data
+         cmd.put(CMD_SET_BITS_ADBUS).put(mode.pstart & ~SK).put(mode.trisl & ~DO);
+
+         // now add RX command, data length 0 = required bytes - 1
+         cmd.put(mode.rx);
+         cmd.putInt(length - 1, 2);
+
+         // we need to make data out an output to send the ACK
+         cmd.put(CMD_SET_BITS_ADBUS).put(mode.pstart & ~SK).put(mode.trisl);
+
+         // and send ACK bit
+         cmd.put(mode.tx | MPSSE_BITMODE).put(0).put(mode.tack);
+
+         return length;
+      }
+
+      // SPI mode, split request in blocks of maximum transfer size
+      for (unsigned int offset = 0; offset < length; offset += txsize)
+      {
+         const unsigned int block = std::min(length - offset, static_cast<unsigned int>(txsize));
 
-         data.flip();
+         // now add RX command, data length 0 = 1 byte
+         cmd.put(mode.rx);
+         cmd.putInt(block - 1, 2);
       }
 
-      LOG_DEBUG(log, "MPSSE RX: {x}", {data.copy()});
-
-      return true;
+      return length;
    }
 
-   bool write(const rt::ByteBuffer &data)
+   /*
+    * encode write request, returns the number of bytes that device sends back
+    */
+   unsigned int encodeWrite(rt::ByteBuffer &cmd, const rt::ByteBuffer &data) const
    {
-      if (!profile)
-         return false;
-
-      LOG_INFO(log, "write {} bytes", {data.remaining()});
-
-      LOG_DEBUG(log, "MPSSE TX: {x}", {data.copy()});
+      const unsigned int length = data.remaining();
 
       // I2C mode
       if (protocol == I2C)
       {
-         rt::ByteBuffer cmd(16);
-         rt::ByteBuffer ack(1);
-
-         for (int i = 0; i < data.remaining(); i++)
+         for (unsigned int i = 0; i < length; i++)
          {
             // ensure that the clock pin is set low prior to clocking out data
             cmd.put(CMD_SET_BITS_ADBUS).put(mode.pstart & ~SK).put(mode.trisl);
 
             // now add TX command, data length 0 = 1 byte for I2C
-            cmd.put(mode.tx).put(0).put(0).put(data[i]);
+            cmd.put(mode.tx).put(0).put(0).put(data[data.position() + i]);
 
             // we need to make data out an input to avoid contention
             cmd.put(CMD_SET_BITS_ADBUS).put(mode.pstart & ~SK).put(mode.trisl & ~DO);
 
             // and read ACK after each byte
-            cmd.put(mode.rx | MPSSE_BITMODE).put(0).put(CMD_SEND_IMMEDIATE);
-
-            // prepare buffer for send
-            cmd.flip();
-
-            // prepare buffer for receive ACK
-            ack.clear();
-
-            // send!
-            if (!ftdiSend(cmd))
-            {
-               log->error("failed to send write request in I2C mode");
-               return false;
-            }
-
-            // and read back ACK
-            if (!ftdiRecv(ack))
-            {
-               log->error("failed to read ACK in I2C mode");
-               return false;
-            }
-
-            // store ack
-            mode.tack = ack.get();
+            cmd.put(mode.rx | MPSSE_BITMODE).put(0);
          }
 
-         return true;
+         // one ACK byte is returned for each byte written
+         return length;
       }
 
-      // SPI mode
-      rt::ByteBuffer block(txsize);
-      rt::ByteBuffer payload(data);
-      rt::ByteBuffer cmd(txsize + 3);
-
-      while (payload.remaining() > 0)
+      // SPI mode, split data in blocks of maximum transfer size
+      for (unsigned int offset = 0; offset < length; offset += txsize)
       {
-         payload.get(block);
+         const unsigned int block = std::min(length - offset, static_cast<unsigned int>(txsize));
 
-         // now add TX command, data length 0 = 1 byte for I2C
+         // now add TX command, data length 0 = 1 byte
          cmd.put(mode.tx);
-         cmd.putInt(block.remaining() - 1, 2);
-         cmd.put(block);
-         cmd.flip();
+         cmd.putInt(block - 1, 2);
+         cmd.put(data.ptr() + offset, block);
+      }
 
-         // send!
-         if (!ftdiSend(cmd))
-         {
-            log->error("failed to write data in SPI mode");
-            return false;
-         }
+      return 0;
+   }
 
-         // prepare for next block
-         cmd.clear();
-      }
+   /*
+    * maximum number of command bytes required to encode a read request
+    */
+   unsigned int readSize(const unsigned int length) const
+   {
+      return protocol == I2C ? 12 : (length / txsize + 1) * 3;
+   }
 
-      return true;
+   /*
+    * maximum number of command bytes required to encode a write request
+    */
+   unsigned int writeSize(const unsigned int length) const
+   {
+      return protocol == I2C ? length * 12 : (length / txsize + 1) * 3 + length;
    }
 
    bool setClock(const unsigned int freq)
    {
       LOG_INFO(log, "setClock, frequency {}Hz", {freq});
 
-      const unsigned int sck = freq > CLK_6MHZ ? CLK_6MHZ : CLK_12MHZ;
-      const unsigned int div = freq > 0 ? (sck / freq) / 2 - 1 : 0xFFFF;
-
-      rt::ByteBuffer cmd1(32);
-      cmd1.put(freq > CLK_6MHZ ? CMD_TCK_X5 : CMD_TCK_D5).flip();
+      if (freq == 0)
+      {
+         log->error("invalid clock frequency {}Hz", {freq});
+         return false;
+      }
 
-      if (!ftdiSend(cmd1))
+      // direct commands are not processed while a wait is armed
+      if (pending && !cancel())
          return false;
 
-      rt::ByteBuffer cmd2(32);
-      cmd2.put(CMD_TCK_DIVISOR);
-      cmd2.putInt(div, 2);
-      cmd2.flip();
+      // TCK = base / ((1 + div) * 2), use 60MHz base clock unless divisor does not fit in 16 bits
+      const bool x5 = CLK_60MHZ / (2 * freq) <= 0x10000;
+      const unsigned int base = x5 ? CLK_60MHZ : CLK_12MHZ;
+
+      // round divisor up so resulting clock never exceeds requested frequency
+      const unsigned int div = std::min((base + 2 * freq - 1) / (2 * freq), 0x10000u) - 1;
 
-      if (!ftdiSend(cmd2))
+      direct.clear();
+      direct.put(x5 ? CMD_TCK_X5 : CMD_TCK_D5);
+      direct.put(CMD_TCK_DIVISOR);
+      direct.putInt(div, 2);
+      direct.flip();
+
+      if (!ftdiSend(direct))
          return false;
 
-      clock = sck / ((1 + div) * 2);
+      clock = base / ((1 + div) * 2);
+
+      LOG_INFO(log, "setClock, effective frequency {}Hz", {clock});
 
       return true;
    }
@@ -585,11 +1376,6 @@ struct MPSSE::Impl
       // set ACK by default
       mode.tack = 0x00;
 
-      rt::ByteBuffer cmd(32);
-
-      // Ensure adaptive clock is disabled
-      cmd.put(CMD_DISABLE_ADAPTIVE_CLOCK);
-
       switch (proto)
       {
          case SPI0:
@@ -634,26 +1420,40 @@ struct MPSSE::Impl
             mode.pidle |= DO | DI;
             mode.pstart &= ~DO & ~DI;
             mode.pstop &= ~DO & ~DI;
-            cmd.put(CMD_ENABLE_3_PHASE_CLOCK);
             break;
          default:
             return false;
       }
 
-      cmd.flip();
+      protocol = proto;
 
-      if (!ftdiSend(cmd))
-         return false;
+      return applyMode();
+   }
 
-      if (!ftdiGpioLow(mode.pidle))
-         return false;
+   /*
+    * send current mode configuration and pin states to device
+    */
+   bool applyMode()
+   {
+      updateSequences();
 
-      if (!ftdiGpioHigh(mode.gpioh))
-         return false;
+      direct.clear();
 
-      protocol = proto;
+      // Ensure adaptive clock is disabled
+      direct.put(CMD_DISABLE_ADAPTIVE_CLOCK);
 
-      return true;
+      // I2C requires 3-phase data clocking, SPI must disable it
+      direct.put(protocol == I2C ? CMD_ENABLE_3_PHASE_CLOCK : CMD_DISABLE_3_PHASE_CLOCK);
+
+      // restore idle pin states
+      encodeGpioLow(direct, mode.pidle);
+
+      if (profile->acbus)
+         encodeGpioHigh(direct, mode.gpioh);
+
+      direct.flip();
+
+      return ftdiSend(direct);
    }
 
    /* get the GPIO pins high/low */
@@ -672,6 +1472,10 @@ struct MPSSE::Impl
    /* set the GPIO pins high/low */
    bool setGpio(const int gpio, const int value)
    {
+      // direct commands are not processed while a wait is armed
+      if (pending && !cancel())
+         return false;
+
       // ADBUS GPIO
       if (gpio >= GPIOL0 && gpio <= GPIOL3 && status == Stopped)
       {
@@ -690,11 +1494,19 @@ struct MPSSE::Impl
             mode.pidle &= ~pin;
          }
 
+         updateSequences();
+
          return ftdiGpioLow(mode.pstart);
       }
 
       if (gpio >= GPIOH0 && gpio <= GPIOH7)
       {
+         if (!profile->acbus)
+         {
+            log->error("device {} has no high byte GPIO", {profile->description});
+            return false;
+         }
+
          // Convert pin number (4 - 11) to the corresponding pin bit
          const int pin = 1 << (gpio - GPIOH0);
 
@@ -711,61 +1523,160 @@ struct MPSSE::Impl
 
    int ftdiReadPins(unsigned char &val) const
    {
+      if (transport == TRANSPORT_USB)
+         return usb.vendorRequest(Usb::In, SIO_READ_PINS_REQUEST, 0, usbIndex, &val, 1, USB_TIMEOUT) == 1;
+
+      std::lock_guard lock(ftdiMutex);
+
+      if (transport == TRANSPORT_LINK)
+         return link->readPins(val);
+
       if (ftdi_read_pins(ftdi, &val) < 0)
          return false;
 
       return true;
    }
 
-   int ftdiGpioLow(const int value) const
+   bool ftdiBitmode(const int bitmode) const
+   {
+      if (transport == TRANSPORT_USB)
+         return usb.vendorRequest(Usb::Out, SIO_SET_BITMODE_REQUEST, bitmode << 8, usbIndex, nullptr, 0, USB_TIMEOUT) == 0;
+
+      std::lock_guard lock(ftdiMutex);
+
+      if (transport == TRANSPORT_LINK)
+         return link->setBitmode(bitmode);
+
+      return ftdi_set_bitmode(ftdi, 0, bitmode) == 0;
+   }
+
+   void ftdiPurge() const
+   {
+      if (transport == TRANSPORT_USB)
+      {
+         usb.vendorRequest(Usb::Out, SIO_RESET_REQUEST, SIO_TCIFLUSH, usbIndex, nullptr, 0, USB_TIMEOUT);
+         return;
+      }
+
+      std::lock_guard lock(ftdiMutex);
+
+      if (transport == TRANSPORT_LINK)
+      {
+         link->purge();
+         return;
+      }
+
+      ftdi_tciflush(ftdi);
+   }
+
+   int ftdiGpioLow(const int value)
+   {
+      direct.clear();
+      encodeGpioLow(direct, value);
+      direct.flip();
+      return ftdiSend(direct);
+   }
+
+   void encodeGpioLow(rt::ByteBuffer &cmd, const int value) const
+   {
+      cmd.put(CMD_SET_BITS_ADBUS).put(value).put(mode.trisl);
+   }
+
+   int ftdiGpioHigh(const int value)
    {
-      rt::ByteBuffer cmd(32);
-      cmd.put(CMD_SET_BITS_ADBUS).put(value).put(mode.trisl).flip();
-      return ftdiSend(cmd);
+      direct.clear();
+      encodeGpioHigh(direct, value);
+      direct.flip();
+      return ftdiSend(direct);
    }
 
-   int ftdiGpioHigh(const int value) const
+   void encodeGpioHigh(rt::ByteBuffer &cmd, const int value) const
    {
-      rt::ByteBuffer cmd(32);
-      cmd.put(CMD_SET_BITS_ACBUS).put(value).put(mode.trish).flip();
-      return ftdiSend(cmd);
+      cmd.put(CMD_SET_BITS_ACBUS).put(value).put(mode.trish);
    }
 
-   int ftdiLoopback(const bool enable) const
+   int ftdiLoopback(const bool enable)
    {
-      rt::ByteBuffer cmd(32);
-      cmd.put(enable ? LOOPBACK_START : LOOPBACK_END).flip();
-      return ftdiSend(cmd);
+      direct.clear();
+      direct.put(enable ? LOOPBACK_START : LOOPBACK_END).flip();
+      return ftdiSend(direct);
    }
 
    bool ftdiSend(const rt::ByteBuffer &data) const
    {
+      if (transport == TRANSPORT_USB)
+         return usbSend(data);
+
       LOG_DEBUG(log, "FTDI TX: {x}", {data.copy()});
 
+      std::lock_guard lock(ftdiMutex);
+
+      if (transport == TRANSPORT_LINK)
+         return link->write(data.ptr(), data.remaining());
+
       if (const auto res = ftdi_write_data(ftdi, data.ptr(), static_cast<int>(data.remaining())); res != data.remaining())
          return false;
 
       return true;
    }
 
+   /*
+    * wait for asynchronous transfer completion, returns transferred bytes or -1 on error or timeout
+    */
+   int ftdiWait(ftdi_transfer_control *tc, const int timeout) const
+   {
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+      timeval tv {0, 1000};
+
+      // lock is released between event slices so other thread can use the context meanwhile
+      while (true)
+      {
+         std::lock_guard lock(ftdiMutex);
+
+         if (tc->completed)
+            break;
+
+         if (timeout >= 0 && std::chrono::steady_clock::now() > deadline)
+         {
+            ftdi_transfer_data_cancel(tc, nullptr);
+            return -1;
+         }
+
+         if (libusb_handle_events_timeout_completed(ftdi->usb_ctx, &tv, &tc->completed) < 0)
+            break;
+      }
+
+      std::lock_guard lock(ftdiMutex);
+
+      return ftdi_transfer_data_done(tc);
+   }
+
    bool ftdiRecv(rt::ByteBuffer &data, const int timeout = -1) const
    {
-      int r = 0;
+      if (transport == TRANSPORT_USB)
+         return usbRecv(data, timeout);
 
-      // set FTDI USB timeout
-      if (timeout >= 0)
-         ftdi->usb_read_timeout = timeout;
+      int r = 0;
 
-      // always restore timeout on finish
-      rt::Finally restore([&] { ftdi->usb_read_timeout = USB_TIMEOUT; });
+      // data is polled every latency period, so timeout is controlled here instead of USB transfer
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
 
       while (data.remaining() > 0)
       {
-         // read next data block
-         if (r = ftdi_read_data(ftdi, data.ptr(), static_cast<int>(data.remaining())); r < 0)
-            return false;
+         // read next data block, lock is held only for each read so worker is not blocked by long waits
+         {
+            std::lock_guard lock(ftdiMutex);
+
+            if (r = transport == TRANSPORT_LINK ? link->read(data.ptr(), data.remaining()) : ftdi_read_data(ftdi, data.ptr(), static_cast<int>(data.remaining())); r < 0)
+               return false;
+         }
 
          data.skip(r);
+
+         // check timeout only when no data is received
+         if (r == 0 && timeout >= 0 && std::chrono::steady_clock::now() > deadline)
+            return false;
       }
 
       data.flip();
@@ -775,6 +1686,92 @@ struct MPSSE::Impl
       return true;
    }
 
+   bool usbSend(const rt::ByteBuffer &data) const
+   {
+      LOG_DEBUG(log, "USB TX: {x}", {data.copy()});
+
+      return usb.syncTransfer(Usb::Out, usbEndpointOut, data.ptr(), data.remaining(), USB_TIMEOUT) == static_cast<int>(data.remaining());
+   }
+
+   /*
+    * receive data straight into buffer, the two modem status bytes that start each USB packet are
+    * stripped in place, so buffer capacity must have room for them (see recvSize)
+    */
+   bool usbRecv(rt::ByteBuffer &data, const int timeout = -1) const
+   {
+      unsigned char *target = data.ptr();
+
+      const unsigned int length = data.remaining();
+      const unsigned int room = data.capacity() - data.position();
+
+      unsigned int received = 0;
+
+      // data is polled every latency period, so timeout is controlled here instead of USB transfer
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+      while (received < length)
+      {
+         // only whole packets can be requested, shorter transfers overflow
+         const unsigned int request = (room - received) / packetSize * packetSize;
+
+         if (request == 0)
+         {
+            log->error("no room for response of {} bytes", {length});
+            return false;
+         }
+
+         unsigned char *packets = target + received;
+
+         const int r = usb.syncTransfer(Usb::In, usbEndpointIn, packets, request, USB_TIMEOUT);
+
+         if (r < 0)
+            return false;
+
+         const unsigned int start = received;
+
+         // move payload of each packet over status bytes, never behind received data
+         for (unsigned int offset = 0; offset < static_cast<unsigned int>(r) && received < length; offset += packetSize)
+         {
+            const unsigned int size = std::min(static_cast<unsigned int>(r) - offset, packetSize);
+
+            if (size <= USB_STATUS_SIZE)
+               continue;
+
+            const unsigned int payload = std::min(size - USB_STATUS_SIZE, length - received);
+
+            std::memmove(target + received, packets + offset + USB_STATUS_SIZE, payload);
+
+            received += payload;
+         }
+
+         // check timeout only when no data is received, keeping partial data for resumed waits
+         if (received == start && timeout >= 0 && std::chrono::steady_clock::now() > deadline)
+         {
+            data.skip(received);
+            return false;
+         }
+      }
+
+      data.skip(length);
+      data.flip();
+
+      LOG_DEBUG(log, "USB RX: {x}", {data.copy()});
+
+      return true;
+   }
+
+   /*
+    * buffer capacity required to receive response of given length
+    */
+   unsigned int recvSize(const unsigned int length) const
+   {
+      if (transport != TRANSPORT_USB)
+         return length;
+
+      // status bytes of all packets plus one packet of room, transfers are requested in whole packets
+      return length + (length / (packetSize - USB_STATUS_SIZE) + 1) * USB_STATUS_SIZE + packetSize;
+   }
+
    std::string deviceName() const
    {
       if (!profile)
@@ -785,12 +1782,21 @@ struct MPSSE::Impl
 
    std::string ftdiError() const
    {
+      if (transport == TRANSPORT_LINK)
+         return nack >= 0 ? "NACK received at byte " + std::to_string(nack) : link->error();
+
       if (!ftdi)
          return "ftdi library initialization error";
 
       if (!profile)
          return "no device opened";
 
+      if (nack >= 0)
+         return "NACK received at byte " + std::to_string(nack);
+
+      if (transport == TRANSPORT_USB)
+         return usb.lastError();
+
       return {ftdi_get_error_string(ftdi)};
    }
 
@@ -800,9 +1806,36 @@ MPSSE::MPSSE() : impl(std::make_shared<Impl>())
 {
 }
 
-bool MPSSE::open(const Protocol protocol, const unsigned int clock, ByteOrder endianess)
+std::vector<MPSSE::Device> MPSSE::list()
+{
+   std::vector<Device> devices;
+
+   for (const auto &[dev, profile]: Impl::scan())
+   {
+      devices.push_back({
+         .index = static_cast<int>(devices.size()),
+         .vid = dev.vid,
+         .pid = dev.pid,
+         .bus = dev.bus,
+         .port = dev.port,
+         .address = dev.address,
+         .channels = profile->channels,
+         .serial = dev.serial,
+         .description = profile->description,
+      });
+   }
+
+   return devices;
+}
+
+bool MPSSE::open(const Protocol protocol, const unsigned int clock, ByteOrder endianess, Transport transport, const std::string &device, Channel channel)
 {
-   return impl->open(protocol, clock, endianess);
+   return impl->open(protocol, clock, endianess, transport, device, channel);
+}
+
+bool MPSSE::open(const std::shared_ptr<Link> &link, const Protocol protocol, const unsigned int clock, const ByteOrder endianess)
+{
+   return impl->open(link, protocol, clock, endianess);
 }
 
 void MPSSE::close()
@@ -830,9 +1863,9 @@ bool MPSSE::write(const rt::ByteBuffer &data) const
    return impl->write(data);
 }
 
-bool MPSSE::queue(std::function<void(Queue *ops)> &batch) const
+bool MPSSE::queue(const Batch &batch) const
 {
-   return false;
+   return impl->queue(batch);
 }
 
 int MPSSE::getGpio(const GPIO gpio) const
@@ -845,6 +1878,50 @@ bool MPSSE::setGpio(const GPIO gpio, const int value) const
    return impl->setGpio(gpio, value);
 }
 
+bool MPSSE::submit(const Batch &batch, const Completion &completion) const
+{
+   return impl->submit(batch, completion);
+}
+
+std::future<bool> MPSSE::submit(const Batch &batch) const
+{
+   const auto result = std::make_shared<std::promise<bool>>();
+
+   impl->submit(batch, [result](bool success) { result->set_value(success); });
+
+   return result->get_future();
+}
+
+void MPSSE::flush() const
+{
+   impl->drain(true);
+}
+
+unsigned long MPSSE::allocations() const
+{
+   return impl->allocations;
+}
+
+bool MPSSE::waitGpio(const GPIO gpio, const Wait level, const int timeout) const
+{
+   return impl->queue([&](Queue *ops) { ops->wait(gpio, level, timeout); });
+}
+
+bool MPSSE::isPending() const
+{
+   return impl->pending;
+}
+
+bool MPSSE::isStarted() const
+{
+   return impl->status == Started;
+}
+
+int MPSSE::nackPosition() const
+{
+   return impl->nack;
+}
+
 int MPSSE::getClock() const
 {
    return impl->clock;
@@ -860,28 +1937,148 @@ std::string MPSSE::deviceName() const
    return impl->deviceName();
 }
 
+std::string MPSSE::deviceSerial() const
+{
+   return impl->serial;
+}
+
 std::string MPSSE::errorString() const
 {
    return impl->ftdiError();
 }
 
+MPSSE::Queue::Impl::Impl(MPSSE::Impl *device) : device(device), cmd(device->allocate(QUEUE_BUFFER_SIZE)), status(device->status)
+{
+   segments.reserve(16);
+}
+
+/*
+ * prepare for next batch keeping all buffers
+ */
+void MPSSE::Queue::Impl::reset()
+{
+   cmd.clear();
+   segments.clear();
+   length = 0;
+   timeout = USB_TIMEOUT;
+   timed = false;
+   status = device->status;
+   wait = false;
+   valid = true;
+}
+
+/*
+ * ensure command buffer has room for next operation plus final SEND_IMMEDIATE
+ */
+void MPSSE::Queue::Impl::reserve(const unsigned int size)
+{
+   if (cmd.remaining() > size)
+      return;
+
+   rt::ByteBuffer tmp = device->allocate(std::max(cmd.capacity() * 2, cmd.position() + size + 1));
+
+   cmd.flip();
+
+   tmp.put(cmd);
+
+   cmd = tmp;
+}
+
+/*
+ * merge timeout of read and wait requests, the larger one is used and any negative one means no limit
+ */
+void MPSSE::Queue::Impl::expect(const int limit)
+{
+   if (!timed || (timeout >= 0 && (limit < 0 || limit > timeout)))
+      timeout = limit;
+
+   timed = true;
+}
+
+/*
+ * get response buffer with room for exactly the expected response length
+ */
+rt::ByteBuffer &MPSSE::Queue::Impl::response()
+{
+   // capacity beyond limit is used by transports that receive framing data in place
+   if (const unsigned int size = device->recvSize(length); rsp.capacity() < size)
+      rsp = device->allocate(std::max(size, static_cast<unsigned int>(QUEUE_BUFFER_SIZE)));
+
+   rsp.clear();
+   rsp.trim(rsp.capacity() - length);
+
+   return rsp;
+}
+
+MPSSE::Queue::Queue(std::shared_ptr<Impl> impl) : impl(std::move(impl))
+{
+}
+
 MPSSE::Queue *MPSSE::Queue::start()
 {
+   impl->reserve(START_STOP_SIZE);
+   impl->device->encodeStart(impl->cmd);
+
    return this;
 }
 
 MPSSE::Queue *MPSSE::Queue::stop()
 {
+   impl->reserve(START_STOP_SIZE);
+   impl->device->encodeStop(impl->cmd);
+
    return this;
 }
 
-MPSSE::Queue *MPSSE::Queue::read(rt::ByteBuffer &data, int timeout)
+MPSSE::Queue *MPSSE::Queue::read(rt::ByteBuffer &data, const int timeout)
 {
+   const unsigned int length = data.remaining();
+
+   impl->reserve(impl->device->readSize(length));
+
+   if (const unsigned int count = impl->device->encodeRead(impl->cmd, length))
+   {
+      impl->segments.push_back({&data, count, false});
+      impl->length += count;
+   }
+
+   impl->expect(timeout);
+
    return this;
 }
 
 MPSSE::Queue *MPSSE::Queue::write(const rt::ByteBuffer &data)
 {
+   impl->reserve(impl->device->writeSize(data.remaining()));
+
+   // response bytes for write requests are I2C ACKs, verified after batch execution
+   if (const unsigned int count = impl->device->encodeWrite(impl->cmd, data))
+   {
+      impl->segments.push_back({nullptr, count, true});
+      impl->length += count;
+   }
+
+   return this;
+}
+
+
+MPSSE::Queue *MPSSE::Queue::wait(const GPIO gpio, const Wait level, const int timeout)
+{
+   impl->reserve(WAIT_SIZE);
+
+   if (!impl->device->encodeWait(impl->cmd, gpio, level))
+   {
+      impl->valid = false;
+      return this;
+   }
+
+   // pin state read after wait is discarded, only used to get completion
+   impl->segments.push_back({nullptr, 1, false});
+   impl->length += 1;
+   impl->wait = true;
+
+   impl->expect(timeout);
+
    return this;
 }
 
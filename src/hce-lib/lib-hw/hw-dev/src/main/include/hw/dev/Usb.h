@@ -25,6 +25,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <functional>
 
 /* 'interface' might be defined as a macro on Windows, so we need to
  * undefine it so as not to break the current API. */
@@ -51,9 +52,11 @@ class Usb
          int vid;
          int pid;
          int bus;
+         int port;
          int address;
          std::string manufacturer;
          std::string product;
+         std::string serial;
       } Descriptor;
 
       enum TransferStatus
@@ -101,6 +104,8 @@ class Usb
 
       bool ctrlTransfer(int outCmd, const void *txData, unsigned int txSize, int inCmd = 0, void *rxData = nullptr, unsigned int rxSize = 0, int timeout = 3000, int wait = 10) const;
 
+      int vendorRequest(Direction direction, int request, int value, int index, void *data = nullptr, unsigned int length = 0, int timeout = 3000) const;
+
       int syncTransfer(Direction direction, int endpoint, void *data, unsigned int length, int timeout = 30000) const;
 
       bool asyncTransfer(Direction direction, int endpoint, Transfer *transfer) const;
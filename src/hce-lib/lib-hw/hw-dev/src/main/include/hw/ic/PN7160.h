@@ -22,9 +22,11 @@
 #ifndef DEV_PN7160_H
 #define DEV_PN7160_H
 
+#include <memory>
 #include <string>
 
 #include <rt/ByteBuffer.h>
+#include <rt/Waitable.h>
 
 namespace hw {
 
@@ -67,6 +69,31 @@ class PN7160
          DISCOVERY_POLL = 1,
       };
 
+      enum RfState
+      {
+         RF_STATE_IDLE = 0,
+         RF_STATE_DISCOVERY = 1,
+         RF_STATE_LISTEN_ACTIVE = 2,
+         RF_STATE_LISTEN_SLEEP = 3,
+      };
+
+      enum DeactivationType
+      {
+         DEACTIVATE_IDLE = 0,
+         DEACTIVATE_SLEEP = 1,
+         DEACTIVATE_SLEEP_AF = 2,
+         DEACTIVATE_DISCOVERY = 3,
+      };
+
+      enum DeactivationReason
+      {
+         DEACTIVATE_DH_REQUEST = 0,
+         DEACTIVATE_ENDPOINT_REQUEST = 1,
+         DEACTIVATE_RF_LINK_LOSS = 2,
+         DEACTIVATE_BAD_AFI = 3,
+         DEACTIVATE_DH_REQUEST_FAILED = 4,
+      };
+
       enum ParamId
       {
          // Common Discovery Parameters
@@ -166,6 +193,27 @@ class PN7160
          rt::ByteBuffer value;
       };
 
+      struct Deactivation
+      {
+         int type;
+         int reason;
+      };
+
+      struct Activation
+      {
+         int discoveryId;
+         int interface;
+         int protocol;
+         int mode; // RF technology and mode used for activation
+         int maxPayload; // max data packet payload
+         int credits; // initial credits, 0xFF if flow control is not used
+         rt::ByteBuffer techParams; // RF technology specific parameters
+         int exchangeMode; // RF technology and mode used for data exchange
+         int txBitRate; // bit rate from NFCC to remote device
+         int rxBitRate; // bit rate from remote device to NFCC
+         rt::ByteBuffer activationParams; // RATS parameter byte for listen NFC-A ISO-DEP
+      };
+
    public:
 
       explicit PN7160(Protocol protocol, unsigned char addr = 0x28);
@@ -178,17 +226,64 @@ class PN7160
 
       void close();
 
+      void setReadWindow(unsigned int size);
+
       bool coreReset(bool resetConfig = true) const;
 
       bool startDiscovery(const std::vector<Parameter> &parameters, int mode) const;
 
       bool stopDiscovery() const;
 
+      /*
+       * push changed parameters to NFCC without reopening device, discovery is briefly stopped if running; on failure
+       * previous values are set again and discovery is resumed, rfState() tells whether NFCC is still discovering
+       */
+      bool updateDiscovery(const std::vector<Parameter> &parameters) const;
+
+      /*
+       * send RF_DISCOVER_CMD again if NFCC went back to idle, without resending parameters, discovery map or routing
+       */
+      bool resumeDiscovery() const;
+
+      /*
+       * current NCI RF state, tracked from notifications as soon as they are received
+       */
+      RfState rfState() const;
+
+      /*
+       * type and reason of last RF_DEACTIVATE_NTF returned by waitEvent
+       */
+      Deactivation lastDeactivation() const;
+
+      /*
+       * last RF_INTF_ACTIVATED_NTF returned by waitEvent, parameters are views over its data buffer so they are valid until it is reused
+       */
+      const Activation &lastActivation() const;
+
       int waitEvent(rt::ByteBuffer &data, int timeout = -1) const;
 
+      /*
+       * raise waitable each time an event is received, so caller can wait for events together with other sources
+       */
+      void attach(const std::shared_ptr<rt::Waitable> &waitable) const;
+
       bool recvData(rt::ByteBuffer &data, int timeout = -1) const;
 
-      bool sendData(const rt::ByteBuffer &data) const;
+      /*
+       * queue data packet for static RF connection, waits up to timeout milliseconds for NCI credits
+       */
+      bool sendData(const rt::ByteBuffer &data, int timeout = 1000) const;
+
+      /*
+       * steady clock nanoseconds when IRQ of last event returned by waitEvent was seen
+       */
+      unsigned long long eventTime() const;
+
+      /*
+       * wait until queued data is sent, returns steady clock nanoseconds when its last byte was sent, or 0 on timeout;
+       * attached waitable is raised on each completed transfer, so caller can poll with timeout 0 instead of waiting
+       */
+      unsigned long long sendTime(int timeout = 1000) const;
 
    private:
 
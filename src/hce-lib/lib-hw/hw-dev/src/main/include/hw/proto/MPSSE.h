@@ -23,6 +23,11 @@
 #define DEV_MPSSE_H
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <future>
+#include <type_traits>
 
 #include <rt/ByteBuffer.h>
 
@@ -64,6 +69,19 @@ class MPSSE
          CLK_60MHZ = 60000000
       };
 
+      enum Transport
+      {
+         TRANSPORT_FTDI = 0,
+         TRANSPORT_USB = 1,
+         TRANSPORT_LINK = 2
+      };
+
+      enum Channel
+      {
+         CHANNEL_A = 0,
+         CHANNEL_B = 1
+      };
+
       enum GPIO
       {
          GPIOL0 = 0,
@@ -86,8 +104,34 @@ class MPSSE
          WAIT_HIGH = 1
       };
 
+      /*
+       * Attached bridge device, index is the position in enumeration order
+       */
+      struct Device
+      {
+         int index;
+         int vid;
+         int pid;
+         int bus;
+         int port;
+         int address;
+         int channels;
+         std::string serial;
+         std::string description;
+      };
+
+      /*
+       * Batch of bus operations encoded in a single MPSSE command buffer, the
+       * whole batch is sent in one USB transfer and all read operations are
+       * served from one response transfer once the batch is completed; the batch waits for its response as long
+       * as the larger timeout of its read and wait operations, negative for no limit
+       */
       class Queue
       {
+         friend class MPSSE;
+
+         struct Impl;
+
          public:
 
             Queue *start();
@@ -97,15 +141,92 @@ class MPSSE
             Queue *read(rt::ByteBuffer &data, int timeout = -1);
 
             Queue *write(const rt::ByteBuffer &data);
+
+            Queue *wait(GPIO gpio, Wait level, int timeout = -1);
+
+         private:
+
+            explicit Queue(std::shared_ptr<Impl> impl);
+
+            std::shared_ptr<Impl> impl;
+      };
+
+      /*
+       * non-owning reference to batch encoding function, only valid during the call it is passed to, so no copy
+       * or allocation is made whatever the function captures
+       */
+      class Batch
+      {
+         public:
+
+            template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Batch>>>
+            Batch(F &&batch) : target(const_cast<void *>(static_cast<const void *>(std::addressof(batch)))), invoke(call<std::remove_reference_t<F>>)
+            {
+            }
+
+            void operator()(Queue *ops) const
+            {
+               invoke(target, ops);
+            }
+
+         private:
+
+            template <typename F>
+            static void call(void *target, Queue *ops)
+            {
+               (*static_cast<F *>(target))(ops);
+            }
+
+            void *target;
+            void (*invoke)(void *target, Queue *ops);
+      };
+
+      /*
+       * byte stream to MPSSE engine of one channel, replaces libftdi / libusb transports so the engine can be driven
+       * by a stand-in without hardware; all calls are serialized by MPSSE
+       */
+      class Link
+      {
+         public:
+
+            virtual ~Link() = default;
+
+            // send command bytes, false if not all of them are accepted
+            virtual bool write(const unsigned char *data, unsigned int length) = 0;
+
+            // receive response bytes already available without blocking, returns number of bytes or -1 on error
+            virtual int read(unsigned char *data, unsigned int length) = 0;
+
+            // set channel bit mode, reset (0x00) or MPSSE (0x02)
+            virtual bool setBitmode(int mode) = 0;
+
+            // current states of low byte pins
+            virtual bool readPins(unsigned char &value) = 0;
+
+            // discard response bytes not read yet
+            virtual void purge() = 0;
+
+            virtual std::string error() const = 0;
       };
 
-      std::function<void(Queue *ops)> Batch;
+      typedef std::function<void(bool success)> Completion;
 
    public:
 
       MPSSE();
 
-      bool open(Protocol protocol, unsigned int clock = 100000, ByteOrder endianess = BYTEORDER_BIG_ENDIAN);
+      static std::vector<Device> list();
+
+      /*
+       * open device selected by serial number, or by enumeration index as "#<index>", first device if empty;
+       * each channel of dual channel devices can be opened by its own instance
+       */
+      bool open(Protocol protocol, unsigned int clock = 100000, ByteOrder endianess = BYTEORDER_BIG_ENDIAN, Transport transport = TRANSPORT_FTDI, const std::string &device = std::string(), Channel channel = CHANNEL_A);
+
+      /*
+       * open over given link instead of an attached device, transport is TRANSPORT_LINK until closed
+       */
+      bool open(const std::shared_ptr<Link> &link, Protocol protocol, unsigned int clock = 100000, ByteOrder endianess = BYTEORDER_BIG_ENDIAN);
 
       void close();
 
@@ -117,18 +238,48 @@ class MPSSE
 
       bool write(const rt::ByteBuffer &data) const;
 
-      bool queue(std::function<void(Queue *ops)> &batch) const;
+      bool queue(const Batch &batch) const;
+
+      bool submit(const Batch &batch, const Completion &completion) const;
+
+      std::future<bool> submit(const Batch &batch) const;
+
+      void flush() const;
 
       int getGpio(GPIO gpio) const;
 
       bool setGpio(GPIO gpio, int value) const;
 
+      bool waitGpio(GPIO gpio, Wait level, int timeout = -1) const;
+
+      /*
+       * batch with wait operation is armed in device, or already completed while it was cancelled by other operations;
+       * it is resumed by executing same batch again
+       */
+      bool isPending() const;
+
+      /*
+       * bus transaction is open, START condition sent and not followed by STOP; a completed batch kept by cancellation
+       * gets its transaction closed
+       */
+      bool isStarted() const;
+
+      int nackPosition() const;
+
+      /*
+       * number of buffers allocated by MPSSE, stable once all arenas are warmed up; transfer state allocated by
+       * libftdi / libusb on each USB transfer is not included
+       */
+      unsigned long allocations() const;
+
       int getClock() const;
 
       bool setClock(unsigned int clock) const;
 
       std::string deviceName() const;
 
+      std::string deviceSerial() const;
+
       std::string errorString() const;
 
    private:
@@ -21,9 +21,20 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+#include <alloca.h>
+#include <sys/mman.h>
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <map>
 #include <mutex>
 #include <queue>
 #include <list>
@@ -34,6 +45,9 @@
 #include <rt/BlockingQueue.h>
 #include <rt/Executor.h>
 
+// maximum stack size touched by pre-faulting, must be well below thread stack size
+#define EXECUTOR_MAX_PREFAULT (1024 * 1024)
+
 namespace rt {
 
 struct Executor::Impl
@@ -43,7 +57,8 @@ struct Executor::Impl
    struct Job
    {
       std::shared_ptr<Task> task;
-      Priority priority;
+      ThreadPolicy policy;
+      std::shared_ptr<std::promise<PolicyStatus>> status;
 
       bool operator==(const Job &other) const
       {
@@ -88,6 +103,11 @@ struct Executor::Impl
       // get current thread id
       std::thread::id id = std::this_thread::get_id();
 
+      // default settings restored after each task, CPUs allowed when thread was started so pinned tasks do not leak
+      ThreadPolicy defaults;
+
+      defaults.cpus = getAffinity();
+
       // main thread loop
       while (!shutdown)
       {
@@ -98,12 +118,17 @@ struct Executor::Impl
 
             runningJobs.add(job);
 
-            // restore priority
-            setPriority(job.priority);
+            // apply task thread settings and report result to submitter, no restriction means initial CPUs
+            const PolicyStatus status = applyPolicy(job.policy, defaults.cpus);
+
+            if (status.failed)
+               log->warn("task {} thread policy not fully applied, failed settings {}", {task->name(), status.failed});
+
+            job.status->set_value(status);
 
             try
             {
-               log->info("task {} started in thread {} with priority {}", {task->name(), id, priorityName(job.priority)});
+               log->info("task {} started in thread {} with scheduler {} priority {}", {task->name(), id, schedulerName(job.policy.scheduler), job.policy.priority});
 
                task->run();
             }
@@ -122,8 +147,8 @@ struct Executor::Impl
 
             log->info("task {} finished in thread {}", {task->name(), id});
 
-            // restore priority
-            setPriority(PRIORITY_NORMAL);
+            // restore default settings
+            applyPolicy(defaults, defaults.cpus);
 
             // on shutdown process do not remove from list to avoid concurrent modification
             if (!shutdown)
@@ -142,12 +167,16 @@ struct Executor::Impl
       log->info("executor thread {} terminated", {id});
    }
 
-   void submit(Task *task, Priority priority)
+   std::future<PolicyStatus> submit(Task *task, const ThreadPolicy &policy)
    {
+      auto status = std::make_shared<std::promise<PolicyStatus>>();
+
+      auto future = status->get_future();
+
       if (!shutdown)
       {
          // add task to wait pool
-         waitingJobs.add({std::shared_ptr<Task>(task), priority});
+         waitingJobs.add({std::shared_ptr<Task>(task), policy, status});
 
          // notify waiting threads
          threadSync.notify_all();
@@ -155,7 +184,11 @@ struct Executor::Impl
       else
       {
          log->warn("submit task rejected, shutdown in progress...");
+
+         status->set_value({0, POLICY_SCHEDULER});
       }
+
+      return future;
    }
 
    void terminate(int timeout)
@@ -195,56 +228,198 @@ struct Executor::Impl
       log->info("all threads terminated, executor service shutdown completed!");
    }
 
-   void setPriority(Priority priority)
+   PolicyStatus applyPolicy(const ThreadPolicy &policy, const std::vector<int> &initial)
+   {
+      PolicyStatus status;
+
+      // scheduler and priority, always applied so defaults are restored after task
+      (setScheduler(policy.scheduler, policy.priority) ? status.applied : status.failed) |= POLICY_SCHEDULER;
+
+      // CPU affinity, empty set allows CPUs thread was started with
+      (setAffinity(policy.cpus.empty() ? initial : policy.cpus) ? status.applied : status.failed) |= POLICY_AFFINITY;
+
+      if (policy.lockMemory)
+         (lockMemory() ? status.applied : status.failed) |= POLICY_MEMORY_LOCK;
+
+      if (policy.prefaultStack)
+         (prefaultStack(policy.prefaultStack) ? status.applied : status.failed) |= POLICY_STACK_PREFAULT;
+
+      return status;
+   }
+
+   bool setScheduler(const int scheduler, const int priority)
    {
 #ifdef _WIN32
       int p = THREAD_PRIORITY_NORMAL;
 
-      switch (priority)
+      // windows has no real-time schedulers for threads, map real-time priority to closest thread priority
+      if (scheduler != SCHEDULER_OTHER)
+         p = priority >= 25 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+      else if (priority < 0)
+         p = THREAD_PRIORITY_LOWEST;
+
+      return SetThreadPriority(GetCurrentThread(), p);
+#else
+      int policy = SCHED_OTHER;
+
+      switch (scheduler)
       {
-         case PRIORITY_LOWEST:
-            p = THREAD_PRIORITY_LOWEST;
+         case SCHEDULER_FIFO:
+            policy = SCHED_FIFO;
             break;
-         case PRIORITY_HIGHEST:
-            p = THREAD_PRIORITY_HIGHEST;
+         case SCHEDULER_RR:
+            policy = SCHED_RR;
             break;
-         case PRIORITY_REALTIME:
-            p = THREAD_PRIORITY_TIME_CRITICAL;
+         default:
             break;
       }
 
-      SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+      sched_param param {0};
+
+      // real-time schedulers require priority in valid range, other scheduler only accepts 0
+      if (policy != SCHED_OTHER)
+         param.sched_priority = std::clamp(priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+
+      if (const int error = pthread_setschedparam(pthread_self(), policy, &param))
+      {
+         log->warn("unable to set scheduler {} priority {}, error {}", {schedulerName(scheduler), param.sched_priority, error});
+         return false;
+      }
+
+      return true;
+#endif
+   }
+
+   bool setAffinity(const std::vector<int> &cpus)
+   {
+#if defined(_WIN32)
+      DWORD_PTR mask = 0;
+
+      for (const int cpu: cpus)
+      {
+         if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8))
+            mask |= static_cast<DWORD_PTR>(1) << cpu;
+      }
+
+      // no restriction, allow all CPUs of the process
+      if (!mask)
+      {
+         DWORD_PTR system;
+
+         if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &system))
+            return false;
+      }
+
+      return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+      cpu_set_t set;
+
+      CPU_ZERO(&set);
+
+      for (const int cpu: cpus)
+      {
+         if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+      }
+
+      // no restriction, allow all CPUs of the process
+      if (!CPU_COUNT(&set) && sched_getaffinity(0, sizeof(set), &set) != 0)
+         return false;
+
+      if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+      {
+         log->warn("unable to set CPU affinity, error {}", {error});
+         return false;
+      }
+
+      return true;
 #else
-      sched_param param {10};
+      return cpus.empty();
+#endif
+   }
+
+   /*
+    * CPUs allowed to calling thread, empty if not available
+    */
+   static std::vector<int> getAffinity()
+   {
+      std::vector<int> cpus;
 
-      switch (priority)
+#if defined(_WIN32)
+      DWORD_PTR mask, system;
+
+      if (GetProcessAffinityMask(GetCurrentProcess(), &mask, &system))
       {
-         case PRIORITY_LOWEST:
-            param = {0};
-            break;
-         case PRIORITY_HIGHEST:
-            param = {0};
-            break;
-         case PRIORITY_REALTIME:
-            param = {25};
-            break;
+         for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); cpu++)
+         {
+            if (mask & static_cast<DWORD_PTR>(1) << cpu)
+               cpus.push_back(cpu);
+         }
+      }
+#elif defined(__linux__)
+      cpu_set_t set;
+
+      CPU_ZERO(&set);
+
+      if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+      {
+         for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+         {
+            if (CPU_ISSET(cpu, &set))
+               cpus.push_back(cpu);
+         }
+      }
+#endif
+
+      return cpus;
+   }
+
+   bool lockMemory()
+   {
+#ifdef __linux__
+      // lock current and future pages, process wide and kept after task finish
+      if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+      {
+         log->warn("unable to lock memory, error {}", {errno});
+         return false;
       }
 
-      pthread_setschedparam(pthread_self(), priority > PRIORITY_NORMAL ? SCHED_RR : SCHED_OTHER, &param);
+      return true;
+#else
+      return false;
 #endif
    }
 
-   static std::string priorityName(const Priority priority)
+#ifdef __linux__
+   __attribute__((noinline)) static bool prefaultStack(const unsigned int size)
+   {
+      const unsigned int length = std::min(size, static_cast<unsigned int>(EXECUTOR_MAX_PREFAULT));
+
+      // touch one byte per page so stack pages are mapped before task starts
+      auto *stack = static_cast<volatile unsigned char *>(alloca(length));
+
+      for (unsigned int i = 0; i < length; i += 4096)
+         stack[i] = 0;
+
+      return length == size;
+   }
+#else
+   static bool prefaultStack(const unsigned int size)
    {
-      // priority names
-      static const std::map<Priority, std::string> names = {
-         {PRIORITY_LOWEST, "LOWEST"},
-         {PRIORITY_NORMAL, "NORMAL"},
-         {PRIORITY_HIGHEST, "HIGHEST"},
-         {PRIORITY_REALTIME, "REALTIME"},
+      return false;
+   }
+#endif
+
+   static std::string schedulerName(const int scheduler)
+   {
+      // scheduler names
+      static const std::map<int, std::string> names = {
+         {SCHEDULER_OTHER, "OTHER"},
+         {SCHEDULER_FIFO, "FIFO"},
+         {SCHEDULER_RR, "RR"},
       };
 
-      if (const auto it = names.find(priority); it != names.end())
+      if (const auto it = names.find(scheduler); it != names.end())
          return it->second;
 
       return "UNKNOWN";
@@ -262,7 +437,36 @@ Executor::~Executor()
 
 void Executor::submit(Task *task, Priority priority)
 {
-   impl->submit(task, priority);
+   impl->submit(task, policy(priority));
+}
+
+std::future<Executor::PolicyStatus> Executor::submit(Task *task, const ThreadPolicy &policy)
+{
+   return impl->submit(task, policy);
+}
+
+Executor::ThreadPolicy Executor::policy(const Priority priority)
+{
+   ThreadPolicy policy;
+
+   switch (priority)
+   {
+      case PRIORITY_LOWEST:
+         policy.priority = -1;
+         break;
+      case PRIORITY_HIGHEST:
+         policy.scheduler = SCHEDULER_RR;
+         policy.priority = 10;
+         break;
+      case PRIORITY_REALTIME:
+         policy.scheduler = SCHEDULER_RR;
+         policy.priority = 25;
+         break;
+      default:
+         break;
+   }
+
+   return policy;
 }
 
 void Executor::shutdown()
@@ -25,8 +25,11 @@
 #include <list>
 #include <mutex>
 #include <condition_variable>
+#include <memory>
 #include <optional>
 
+#include <rt/Waitable.h>
+
 namespace rt {
 
 template <typename T>
@@ -71,6 +74,20 @@ class BlockingQueue
 
       BlockingQueue() = default;
 
+      /*
+       * raise waitable each time an element is added, so queue can be waited together with other sources
+       */
+      void attach(const std::shared_ptr<Waitable> &signal)
+      {
+         std::lock_guard lock(mutex);
+
+         waitable = signal;
+
+         // pending elements must be seen by waiter
+         if (waitable && !queue.empty())
+            waitable->notify();
+      }
+
       void add(T e)
       {
          std::lock_guard lock(mutex);
@@ -80,6 +97,9 @@ class BlockingQueue
 
          // notify for unlock wait
          sync.notify_all();
+
+         if (waitable)
+            waitable->notify();
       }
 
       template <typename... A>
@@ -92,6 +112,9 @@ class BlockingQueue
 
          // notify for unlock wait
          sync.notify_all();
+
+         if (waitable)
+            waitable->notify();
       }
 
       std::optional<T> get(const int milliseconds = 0)
@@ -163,6 +186,9 @@ class BlockingQueue
 
       // synchronization condition
       mutable std::condition_variable sync;
+
+      // shared wake up signal
+      std::shared_ptr<Waitable> waitable;
 };
 
 }
@@ -280,6 +280,22 @@ class Buffer
          return *this;
       }
 
+      /*
+       * view of elements between offset and offset + length, shares storage so no data is copied
+       */
+      Buffer slice(unsigned int offset, unsigned int length) const
+      {
+         assert(alloc != nullptr);
+         assert(offset + length <= state.capacity);
+
+         Buffer view(*this);
+
+         view.state.position = offset;
+         view.state.limit = offset + length;
+
+         return view;
+      }
+
       Buffer &room(unsigned int size)
       {
          assert(alloc != nullptr);
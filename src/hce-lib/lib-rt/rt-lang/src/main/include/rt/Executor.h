@@ -22,7 +22,9 @@
 #ifndef RT_EXECUTOR_H
 #define RT_EXECUTOR_H
 
+#include <future>
 #include <memory>
+#include <vector>
 
 #include <rt/Task.h>
 
@@ -42,6 +44,38 @@ class Executor
          PRIORITY_REALTIME = 3,
       };
 
+      enum Scheduler
+      {
+         SCHEDULER_OTHER = 0,
+         SCHEDULER_FIFO = 1,
+         SCHEDULER_RR = 2,
+      };
+
+      enum PolicyFlags
+      {
+         POLICY_SCHEDULER = 1,
+         POLICY_AFFINITY = 2,
+         POLICY_MEMORY_LOCK = 4,
+         POLICY_STACK_PREFAULT = 8,
+      };
+
+      // thread settings applied while task is running
+      struct ThreadPolicy
+      {
+         int scheduler = SCHEDULER_OTHER;
+         int priority = 0; // real-time priority for FIFO and RR schedulers, negative for background tasks
+         std::vector<int> cpus; // allowed CPUs, empty for no restriction
+         bool lockMemory = false; // lock process memory to avoid page faults
+         unsigned int prefaultStack = 0; // bytes of stack to touch before task starts
+      };
+
+      // policy settings applied and failed, as PolicyFlags
+      struct PolicyStatus
+      {
+         unsigned int applied = 0;
+         unsigned int failed = 0;
+      };
+
    public:
 
       explicit Executor(int poolSize = 100, int coreSize = 4);
@@ -50,6 +84,10 @@ class Executor
 
       void submit(Task *task, Priority priority = PRIORITY_NORMAL);
 
+      std::future<PolicyStatus> submit(Task *task, const ThreadPolicy &policy);
+
+      static ThreadPolicy policy(Priority priority);
+
       void shutdown();
 
    private:
@@ -0,0 +1,171 @@
+/*
+
+  This file is part of HCE-LABORATORY.
+
+  Copyright (C) 2025 Jose Vicente Campos Martinez, <josevcm@gmail.com>
+
+  HCE-LABORATORY is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HCE-LABORATORY is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with HCE-LABORATORY. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RT_HISTOGRAM_H
+#define RT_HISTOGRAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+// sub-buckets per power of two, 2^5 gives about 3% relative error
+#define HISTOGRAM_SUB_BITS 5
+
+// highest tracked magnitude, larger values are counted in last bucket
+#define HISTOGRAM_MAX_BITS 40
+
+namespace rt {
+
+/*
+ * lock-free log-linear histogram (HDR style) for unsigned values, record is wait-free and can be
+ * called from any thread while another one reads percentiles
+ */
+class Histogram
+{
+   static constexpr unsigned int SUB_COUNT = 1u << HISTOGRAM_SUB_BITS;
+   static constexpr unsigned int BUCKETS = (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * SUB_COUNT;
+   static constexpr unsigned long long MAX_VALUE = (1ull << HISTOGRAM_MAX_BITS) - 1;
+
+   public:
+
+      Histogram() = default;
+
+      Histogram(const Histogram &) = delete;
+
+      Histogram &operator=(const Histogram &) = delete;
+
+      void record(unsigned long long value)
+      {
+         if (value > MAX_VALUE)
+            value = MAX_VALUE;
+
+         buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+         total.fetch_add(1, std::memory_order_relaxed);
+         sum.fetch_add(value, std::memory_order_relaxed);
+
+         unsigned long long current = low.load(std::memory_order_relaxed);
+
+         while (value < current && !low.compare_exchange_weak(current, value, std::memory_order_relaxed))
+         {
+         }
+
+         current = high.load(std::memory_order_relaxed);
+
+         while (value > current && !high.compare_exchange_weak(current, value, std::memory_order_relaxed))
+         {
+         }
+      }
+
+      void reset()
+      {
+         for (auto &bucket: buckets)
+            bucket.store(0, std::memory_order_relaxed);
+
+         total.store(0, std::memory_order_relaxed);
+         sum.store(0, std::memory_order_relaxed);
+         low.store(std::numeric_limits<unsigned long long>::max(), std::memory_order_relaxed);
+         high.store(0, std::memory_order_relaxed);
+      }
+
+      unsigned long long count() const
+      {
+         return total.load(std::memory_order_relaxed);
+      }
+
+      unsigned long long min() const
+      {
+         return count() ? low.load(std::memory_order_relaxed) : 0;
+      }
+
+      unsigned long long max() const
+      {
+         return high.load(std::memory_order_relaxed);
+      }
+
+      unsigned long long mean() const
+      {
+         const unsigned long long n = count();
+
+         return n ? sum.load(std::memory_order_relaxed) / n : 0;
+      }
+
+      /*
+       * value below which given percentage (0 to 100) of samples fall, upper bound of its bucket
+       */
+      unsigned long long percentile(const double percent) const
+      {
+         const unsigned long long n = count();
+
+         if (!n)
+            return 0;
+
+         const auto rank = static_cast<unsigned long long>(percent / 100.0 * static_cast<double>(n) + 0.5);
+
+         unsigned long long accumulated = 0;
+
+         for (unsigned int i = 0; i < BUCKETS; i++)
+         {
+            accumulated += buckets[i].load(std::memory_order_relaxed);
+
+            if (accumulated >= rank && accumulated > 0)
+               return std::min(upper(i), max());
+         }
+
+         return max();
+      }
+
+   private:
+
+      static unsigned int index(const unsigned long long value)
+      {
+         if (value < SUB_COUNT)
+            return static_cast<unsigned int>(value);
+
+         unsigned int magnitude = HISTOGRAM_SUB_BITS;
+
+         while (value >> (magnitude + 1))
+            magnitude++;
+
+         const unsigned int shift = magnitude - HISTOGRAM_SUB_BITS;
+
+         return (shift + 1) * SUB_COUNT + static_cast<unsigned int>((value >> shift) & (SUB_COUNT - 1));
+      }
+
+      static unsigned long long upper(const unsigned int index)
+      {
+         if (index < SUB_COUNT)
+            return index;
+
+         const unsigned int shift = index / SUB_COUNT - 1;
+
+         return ((static_cast<unsigned long long>(SUB_COUNT + index % SUB_COUNT) + 1) << shift) - 1;
+      }
+
+      std::atomic<unsigned long long> buckets[BUCKETS] {};
+      std::atomic<unsigned long long> total {0};
+      std::atomic<unsigned long long> sum {0};
+      std::atomic<unsigned long long> low {std::numeric_limits<unsigned long long>::max()};
+      std::atomic<unsigned long long> high {0};
+};
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+/*
+
+  This file is part of HCE-LABORATORY.
+
+  Copyright (C) 2025 Jose Vicente Campos Martinez, <josevcm@gmail.com>
+
+  HCE-LABORATORY is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HCE-LABORATORY is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with HCE-LABORATORY. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RT_RINGQUEUE_H
+#define RT_RINGQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <utility>
+
+namespace rt {
+
+/*
+ * fixed size lock-free queue for one producer and one consumer thread, producer never blocks
+ */
+template <typename T>
+class RingQueue
+{
+   public:
+
+      /*
+       * slots are filled with empty value and reset to it on pop, a shared empty value avoids building new elements per pop
+       */
+      explicit RingQueue(const unsigned int capacity, const T &empty = T()) : empty(empty), slots(roundup(capacity), empty), mask(slots.size() - 1)
+      {
+      }
+
+      RingQueue(const RingQueue &) = delete;
+
+      RingQueue &operator=(const RingQueue &) = delete;
+
+      /*
+       * add element from producer thread, returns false if queue is full
+       */
+      bool push(const T &value)
+      {
+         const unsigned long tail = tailIndex.load(std::memory_order_relaxed);
+
+         if (tail - headIndex.load(std::memory_order_acquire) == slots.size())
+            return false;
+
+         slots[tail & mask] = value;
+
+         tailIndex.store(tail + 1, std::memory_order_release);
+
+         return true;
+      }
+
+      /*
+       * take element from consumer thread, returns false if queue is empty
+       */
+      bool pop(T &value)
+      {
+         const unsigned long head = headIndex.load(std::memory_order_relaxed);
+
+         if (head == tailIndex.load(std::memory_order_acquire))
+            return false;
+
+         // slot is released empty, so resources held by value are not kept until slot is reused
+         value = std::move(slots[head & mask]);
+         slots[head & mask] = empty;
+
+         headIndex.store(head + 1, std::memory_order_release);
+
+         return true;
+      }
+
+      unsigned int size() const
+      {
+         return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+      }
+
+      unsigned int capacity() const
+      {
+         return slots.size();
+      }
+
+   private:
+
+      // value assigned to released slots
+      const T empty;
+
+      static unsigned int roundup(const unsigned int capacity)
+      {
+         unsigned int size = 1;
+
+         while (size < capacity)
+            size <<= 1;
+
+         return size;
+      }
+
+      // queue elements, size is power of two
+      std::vector<T> slots;
+
+      // index mask
+      const unsigned long mask;
+
+      // next element to read, owned by consumer
+      alignas(64) std::atomic<unsigned long> headIndex {0};
+
+      // next element to write, owned by producer
+      alignas(64) std::atomic<unsigned long> tailIndex {0};
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+
+  This file is part of HCE-LABORATORY.
+
+  Copyright (C) 2025 Jose Vicente Campos Martinez, <josevcm@gmail.com>
+
+  HCE-LABORATORY is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HCE-LABORATORY is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with HCE-LABORATORY. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RT_WAITABLE_H
+#define RT_WAITABLE_H
+
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+namespace rt {
+
+/*
+ * level triggered wake up signal, several producers can share it so a single thread waits for any of them
+ */
+class Waitable
+{
+   public:
+
+      Waitable() = default;
+
+      Waitable(const Waitable &) = delete;
+
+      Waitable &operator=(const Waitable &) = delete;
+
+      /*
+       * raise signal, it remains raised until consumed by wait
+       */
+      void notify()
+      {
+         std::lock_guard lock(mutex);
+
+         raised = true;
+
+         sync.notify_all();
+      }
+
+      /*
+       * wait until signal is raised and clear it, 0 returns immediately and negative waits forever
+       */
+      bool wait(const int milliseconds = -1)
+      {
+         std::unique_lock lock(mutex);
+
+         if (milliseconds < 0)
+            sync.wait(lock, [this] { return raised; });
+         else if (!sync.wait_for(lock, std::chrono::milliseconds(milliseconds), [this] { return raised; }))
+            return false;
+
+         raised = false;
+
+         return true;
+      }
+
+   private:
+
+      // signal state
+      bool raised = false;
+
+      // signal mutex
+      std::mutex mutex;
+
+      // synchronization condition
+      std::condition_variable sync;
+};
+
+}
+
+#endif